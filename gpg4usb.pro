@@ -43,7 +43,22 @@ HEADERS += src/attachments.h \
     src/wizard.h \
     src/helppage.h \
     src/findwidget.h \
-    src/gpgconstants.h
+    src/gpgconstants.h \
+    src/gpgkeystore.h \
+    src/gpgkeycache.h \
+    src/gpgdata.h \
+    src/keylistmodel.h \
+    src/keysearchindex.h \
+    src/gpgjob.h \
+    src/jobprogressdialog.h \
+    src/gpgcontextpool.h \
+    src/gpgbatchjob.h \
+    src/batchencryptiondialog.h \
+    src/batchverifydialog.h \
+    src/mimedecoder.h \
+    src/mimeencoder.h \
+    src/batchmode.h \
+    src/gpgserver.h
 
 SOURCES += src/attachments.cpp \
     src/gpgcontext.cpp \
@@ -70,7 +85,22 @@ SOURCES += src/attachments.cpp \
     src/wizard.cpp \
     src/helppage.cpp \
     src/findwidget.cpp \
-    src/gpgconstants.cpp
+    src/gpgconstants.cpp \
+    src/gpgkeystore.cpp \
+    src/gpgkeycache.cpp \
+    src/gpgdata.cpp \
+    src/keylistmodel.cpp \
+    src/keysearchindex.cpp \
+    src/gpgjob.cpp \
+    src/jobprogressdialog.cpp \
+    src/gpgcontextpool.cpp \
+    src/gpgbatchjob.cpp \
+    src/batchencryptiondialog.cpp \
+    src/batchverifydialog.cpp \
+    src/mimedecoder.cpp \
+    src/mimeencoder.cpp \
+    src/batchmode.cpp \
+    src/gpgserver.cpp
 
 RC_FILE = gpg4usb.rc
 
@@ -20,8 +20,6 @@
  */
 
 /* TODO:
- * - check content encoding (base64 / quoted-printable) and apply appropriate opperation (maybe already in mime.cpp)
- * - check memory usage, use less copy operations / more references
  * - possibility to clear attachment-view , e.g. with decryption or encrypting a new message
  * - save all: like in thunderbird, one folder, all files go there
  */
@@ -44,8 +42,8 @@ Attachments::Attachments(QWidget *parent)
     tableView = new QTableView;
     tableView->setModel(table);
     tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
-    // only one entry should be selected at time
-    tableView->setSelectionMode(QAbstractItemView::SingleSelection);
+    // several attachments can be saved at once
+    tableView->setSelectionMode(QAbstractItemView::ExtendedSelection);
     tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
     tableView->setFocusPolicy(Qt::NoFocus);
     tableView->setAlternatingRowColors(true);
@@ -60,6 +58,12 @@ Attachments::Attachments(QWidget *parent)
     setLayout(layout);
     createActions();
 
+    mThreadPool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+Attachments::~Attachments()
+{
+    mThreadPool.waitForDone();
 }
 
 void Attachments::contextMenuEvent(QContextMenuEvent *event)
@@ -89,95 +93,147 @@ void Attachments::createActions()
 
 void Attachments::slotSaveFile()
 {
+    QModelIndexList rows = tableView->selectionModel()->selectedRows();
 
-    QModelIndexList indexes = tableView->selectionModel()->selection().indexes();
-
-    if (indexes.size() < 1) {
+    if (rows.isEmpty()) {
         return;
     }
 
-    // only singe-selection possible now: TODO: foreach
-    MimePart mp = table->getMimePart(indexes.at(0).row());
-    QString filename = mp.header.getParam("Content-Type", "name");
-    // TODO: find out why filename is quoted
-    filename.chop(1);
-    filename.remove(0, 1);
-    // TODO: check if really base64
-    saveByteArrayToFile(QByteArray::fromBase64(mp.body), filename);
-
-}
-
-void  Attachments::saveByteArrayToFile(QByteArray outBuffer, QString filename)
-{
-
-    //QString path="";
-    QString path = filename;
-    QString outfileName = QFileDialog::getSaveFileName(this, tr("Save File"), path);
-
-    if (outfileName.isEmpty()) return;
+    if (rows.size() == 1) {
+        const MimePart &mp = table->getMimePart(rows.at(0).row());
+        QString outfileName = QFileDialog::getSaveFileName(this, tr("Save File"), mp.fileName());
+        if (!outfileName.isEmpty()) {
+            writeFile(mp, outfileName, false);
+        }
+        return;
+    }
 
-    QFile outfile(outfileName);
-    if (!outfile.open(QFile::WriteOnly)) {
-        QMessageBox::warning(this, tr("File"),
-                             tr("Cannot write file %1:\n%2.")
-                             .arg(outfileName)
-                             .arg(outfile.errorString()));
+    // several attachments are saved with their names into one directory
+    QString dirName = QFileDialog::getExistingDirectory(this, tr("Save Files"));
+    if (dirName.isEmpty()) {
         return;
     }
+    QDir dir(dirName);
+
+    QStringList fileNames = uniqueFileNames(rows);
+    QStringList existing;
+    foreach (QString fileName, fileNames) {
+        if (dir.exists(fileName)) {
+            existing << fileName;
+        }
+    }
+    if (!existing.isEmpty()) {
+        QMessageBox::StandardButton ret = QMessageBox::warning(this, tr("File"),
+                tr("These files exist, do you want to overwrite them?\n%1").arg(existing.join("\n")),
+                QMessageBox::Ok | QMessageBox::Cancel);
+        if (ret == QMessageBox::Cancel) {
+            return;
+        }
+    }
 
-    QDataStream out(&outfile);
-    out.writeRawData(outBuffer.data(), outBuffer.length());
-    outfile.close();
+    for (int i = 0; i < rows.size(); i++) {
+        writeFile(table->getMimePart(rows.at(i).row()), dir.filePath(fileNames.at(i)), false);
+    }
 }
 
 /**
  * WIP: TODO:
- *   - create attachments dir if not existing
  *   - ask for cleanup of dir on exit
- *   - remove code-duplication with saveByteArrayToFile
  */
 void Attachments::slotOpenFile() {
 
     // TODO: make attachmentdir constant or configurable
     QString attachmentDir = qApp->applicationDirPath() + "/attachments/";
-    //QDir p = QDir(qApp->applicationDirPath() + "/attachments/");
     if(!QDir(attachmentDir).exists()) {
         QDir().mkpath(attachmentDir);
     }
 
-    QModelIndexList indexes = tableView->selectionModel()->selection().indexes();
-    MimePart mp = table->getMimePart(indexes.at(0).row());
-
-//    qDebug() << "mime: " << mp.header.getValue("Content-Type");
-
-    QString filename = mp.header.getParam("Content-Type", "name");
-    // TODO: find out why filename is quoted
-//    qDebug() << "file: " << filename;
-    filename.chop(1);
-    filename.remove(0, 1);
-    filename.prepend(attachmentDir);
+    QModelIndexList rows = tableView->selectionModel()->selectedRows();
+    QStringList fileNames = uniqueFileNames(rows);
+    for (int i = 0; i < rows.size(); i++) {
+        writeFile(table->getMimePart(rows.at(i).row()), attachmentDir + fileNames.at(i), true);
+    }
+}
 
-  //  qDebug() << "file: " << filename;
-    QByteArray outBuffer = QByteArray::fromBase64(mp.body);
+/** The attachments are written in parallel, so every one needs its own
+ *  file: unnamed parts are called attachment-N, a name used before gets
+ *  a number appended, e.g. letter-2.txt.
+ */
+QStringList Attachments::uniqueFileNames(const QModelIndexList &rows) const
+{
+    QStringList fileNames;
+    QSet<QString> used;
+    foreach (QModelIndex index, rows) {
+        // the name comes from the message, don't let it point elsewhere
+        QFileInfo info(table->getMimePart(index.row()).fileName());
+        QString fileName = info.fileName();
+        if (fileName.isEmpty() || fileName == "." || fileName == "..") {
+            fileName = QString("attachment-%1").arg(index.row() + 1);
+            info.setFile(fileName);
+        }
+        for (int n = 2; used.contains(fileName.toLower()); n++) {
+            fileName = QString("%1-%2").arg(info.baseName()).arg(n);
+            if (!info.completeSuffix().isEmpty()) {
+                fileName += "." + info.completeSuffix();
+            }
+        }
+        used.insert(fileName.toLower());
+        fileNames << fileName;
+    }
+    return fileNames;
+}
 
+/** The attachment is written in a thread of the threadpool, slotFileWritten
+ *  is called, when it is done.
+ */
+void Attachments::writeFile(const MimePart &mp, const QString &fileName, bool open)
+{
+    mThreadPool.start(new AttachmentWriter(this, mp, fileName, open));
+}
 
-    QFile outfile(filename);
-    if (!outfile.open(QFile::WriteOnly)) {
+void Attachments::slotFileWritten(QString fileName, QString errorString, bool open)
+{
+    if (!errorString.isEmpty()) {
         QMessageBox::warning(this, tr("File"),
                              tr("Cannot write file %1:\n%2.")
-                             .arg(filename)
-                             .arg(outfile.errorString()));
+                             .arg(fileName)
+                             .arg(errorString));
         return;
     }
 
-    QDataStream out(&outfile);
-    out.writeRawData(outBuffer.data(), outBuffer.length());
-    outfile.close();
-    QDesktopServices::openUrl(QUrl("file://"+filename, QUrl::TolerantMode));
+    if (open) {
+        QDesktopServices::openUrl(QUrl::fromLocalFile(fileName));
+    }
+}
+
+void Attachments::addMimePart(const MimePart &mp)
+{
+    table->add(mp);
 }
 
-void Attachments::addMimePart(MimePart *mp)
+AttachmentWriter::AttachmentWriter(Attachments *attachments, const MimePart &mp, const QString &fileName, bool open)
 {
-    table->add(*mp);
+    mAttachments = attachments;
+    mPart = mp;
+    mFileName = fileName;
+    mOpen = open;
 }
 
+void AttachmentWriter::run()
+{
+    QString errorString;
+
+    // the decoder writes in large chunks, no need for buffering by QFile
+    QFile outfile(mFileName);
+    if (!outfile.open(QFile::WriteOnly | QIODevice::Unbuffered)) {
+        errorString = outfile.errorString();
+    } else if (!mPart.decodeToDevice(&outfile)) {
+        errorString = outfile.errorString();
+        outfile.close();
+        outfile.remove();
+    }
+
+    QMetaObject::invokeMethod(mAttachments, "slotFileWritten", Qt::QueuedConnection,
+                              Q_ARG(QString, mFileName), Q_ARG(QString, errorString),
+                              Q_ARG(bool, mOpen));
+}
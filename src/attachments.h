@@ -45,16 +45,28 @@ class Attachments : public QWidget
     Q_OBJECT
 
 public slots:
+    /**
+     * @details Save the selected attachments, several ones into a directory.
+     */
     void slotSaveFile();
+    /**
+     * @details Save the selected attachments to the attachment directory and open them.
+     */
     void slotOpenFile();
 
 public:
     Attachments(QWidget *parent = 0);
-    void addMimePart(MimePart *mp);
+    ~Attachments();
+    void addMimePart(const MimePart &mp);
+
+private slots:
+    void slotFileWritten(QString fileName, QString errorString, bool open);
 
 private:
     void createActions();
-    void saveByteArrayToFile(QByteArray outBuffer, QString filename);
+    void writeFile(const MimePart &mp, const QString &fileName, bool open);
+    QStringList uniqueFileNames(const QModelIndexList &rows) const;
+    QThreadPool mThreadPool; /** decodes the attachments into the files in parallel */
     QAction *saveFileAct;
     QAction *openFileAct;
     AttachmentTableModel *table;
@@ -65,4 +77,21 @@ protected:
     void contextMenuEvent(QContextMenuEvent *event);
 };
 
+/**
+ * @brief Decodes an attachment into a file in a thread of the threadpool
+ * of Attachments, the body is streamed from the message into the file.
+ */
+class AttachmentWriter : public QRunnable
+{
+public:
+    AttachmentWriter(Attachments *attachments, const MimePart &mp, const QString &fileName, bool open);
+    void run();
+
+private:
+    Attachments *mAttachments;
+    MimePart mPart;
+    QString mFileName;
+    bool mOpen;
+};
+
 #endif // __ATTACHMENTS_H__
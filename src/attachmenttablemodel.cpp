@@ -36,7 +36,7 @@ AttachmentTableModel::AttachmentTableModel(QList<MimePart> mimeparts, QObject *p
 }
 
 
-void AttachmentTableModel::add(MimePart mp)
+void AttachmentTableModel::add(const MimePart &mp)
 {
     listOfMimeparts.append(mp);
     //QModelIndex changedIndex0 = createIndex(listOfMimeparts.size(), 0);
@@ -47,12 +47,12 @@ void AttachmentTableModel::add(MimePart mp)
     reset();
 }
 
-MimePart AttachmentTableModel::getSelectedMimePart(QModelIndex index)
+const MimePart &AttachmentTableModel::getSelectedMimePart(QModelIndex index) const
 {
     return listOfMimeparts.at(index.row());
 }
 
-MimePart AttachmentTableModel::getMimePart(int index)
+const MimePart &AttachmentTableModel::getMimePart(int index) const
 {
     return listOfMimeparts.at(index);
 }
@@ -89,10 +89,10 @@ QVariant AttachmentTableModel::data(const QModelIndex &index, int role) const
         return QVariant();
 
     if (role == Qt::DisplayRole) {
-        MimePart mp = listOfMimeparts.at(index.row());
+        const MimePart &mp = listOfMimeparts.at(index.row());
 
         if (index.column() == 0)
-            return mp.header.getParam("Content-Type", "name");
+            return mp.fileName();
         if (index.column() == 1)
             return mp.header.getValue("Content-Type");
 
@@ -101,7 +101,7 @@ QVariant AttachmentTableModel::data(const QModelIndex &index, int role) const
     // set icon
     // TODO more generic matching, e.g. for audio
     if (role == Qt::DecorationRole && index.column() == 0) {
-        MimePart mp = listOfMimeparts.at(index.row());
+        const MimePart &mp = listOfMimeparts.at(index.row());
         QString icon;
         if (mp.header.getValue("Content-Type").startsWith("image")) {
             icon = ":mimetypes/image-x-generic.png";
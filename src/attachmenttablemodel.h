@@ -44,9 +44,9 @@ public:
     QVariant data(const QModelIndex &index, int role) const;
     QVariant headerData(int section, Qt::Orientation orientation, int role) const;
 
-    void add(MimePart mp);
-    MimePart getSelectedMimePart(QModelIndex index);
-    MimePart getMimePart(int index);
+    void add(const MimePart &mp);
+    const MimePart &getSelectedMimePart(QModelIndex index) const;
+    const MimePart &getMimePart(int index) const;
     //QList<MimePart> getSelectedMimeParts(QModelIndexList indexes);
 
 private:
@@ -0,0 +1,220 @@
+/*
+ *      batchencryptiondialog.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "batchencryptiondialog.h"
+
+BatchEncryptionDialog::BatchEncryptionDialog(GpgME::GpgContext *ctx, QStringList keyList, QWidget *parent)
+    : QDialog(parent)
+{
+    mCtx = ctx;
+    mJob = 0;
+
+    setWindowTitle(tr("Encrypt Multiple Files"));
+    resize(600, 500);
+    setModal(true);
+
+    /* Setup file table */
+    QGroupBox *fileBox = new QGroupBox(tr("Files"));
+    fileTable = new QTableWidget(0, 2);
+    fileTable->verticalHeader()->hide();
+    fileTable->setShowGrid(false);
+    fileTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    fileTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    fileTable->setAlternatingRowColors(true);
+    QStringList labels;
+    labels << tr("File") << tr("Status");
+    fileTable->setHorizontalHeaderLabels(labels);
+    fileTable->setColumnWidth(0, 350);
+    fileTable->horizontalHeader()->setStretchLastSection(true);
+
+    addFilesButton = new QPushButton(tr("Add Files..."));
+    connect(addFilesButton, SIGNAL(clicked()), this, SLOT(slotAddFiles()));
+    addDirectoryButton = new QPushButton(tr("Add Directory..."));
+    connect(addDirectoryButton, SIGNAL(clicked()), this, SLOT(slotAddDirectory()));
+    removeButton = new QPushButton(tr("Remove"));
+    connect(removeButton, SIGNAL(clicked()), this, SLOT(slotRemoveFiles()));
+
+    QVBoxLayout *fileButtonLayout = new QVBoxLayout();
+    fileButtonLayout->addWidget(addFilesButton);
+    fileButtonLayout->addWidget(addDirectoryButton);
+    fileButtonLayout->addWidget(removeButton);
+    fileButtonLayout->addStretch(0);
+
+    QHBoxLayout *fileLayout = new QHBoxLayout();
+    fileLayout->addWidget(fileTable);
+    fileLayout->addLayout(fileButtonLayout);
+    fileBox->setLayout(fileLayout);
+
+    overwriteCheckBox = new QCheckBox(tr("Overwrite existing output files"));
+
+    /*Setup KeyList*/
+    mKeyList = new KeyList(mCtx);
+    mKeyList->setColumnWidth(2, 150);
+    mKeyList->setColumnWidth(3, 150);
+    mKeyList->setChecked(&keyList);
+
+    progressBar = new QProgressBar();
+    progressBar->setRange(0, 1);
+    progressBar->setValue(0);
+
+    statusLabel = new QLabel();
+    statusLabel->setStyleSheet("QLabel {color: red;}");
+
+    buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
+    encryptButton = buttonBox->addButton(tr("Encrypt"), QDialogButtonBox::AcceptRole);
+    connect(buttonBox, SIGNAL(accepted()), this, SLOT(slotExecuteAction()));
+    connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+    QVBoxLayout *vbox = new QVBoxLayout();
+    vbox->addWidget(fileBox);
+    vbox->addWidget(overwriteCheckBox);
+    vbox->addWidget(mKeyList);
+    vbox->addWidget(progressBar);
+    vbox->addWidget(statusLabel);
+    vbox->addWidget(buttonBox);
+    setLayout(vbox);
+
+    exec();
+}
+
+void BatchEncryptionDialog::slotAddFiles()
+{
+    QStringList fileNames = QFileDialog::getOpenFileNames(this, tr("Open Files"));
+    foreach (QString fileName, fileNames) {
+        addFileRow(fileName, "");
+    }
+}
+
+void BatchEncryptionDialog::slotAddDirectory()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Open Directory"));
+    if (!dir.isEmpty()) {
+        addFileRow(dir, tr("Directory"));
+    }
+}
+
+void BatchEncryptionDialog::slotRemoveFiles()
+{
+    QList<QTableWidgetSelectionRange> ranges = fileTable->selectedRanges();
+    // remove from bottom, to keep the row numbers of the other ranges valid
+    for (int i = ranges.size() - 1; i >= 0; i--) {
+        for (int row = ranges.at(i).bottomRow(); row >= ranges.at(i).topRow(); row--) {
+            fileTable->removeRow(row);
+        }
+    }
+}
+
+void BatchEncryptionDialog::addFileRow(const QString &fileName, const QString &status)
+{
+    int row = fileTable->rowCount();
+    fileTable->setRowCount(row + 1);
+    QTableWidgetItem *fileItem = new QTableWidgetItem(fileName);
+    fileItem->setToolTip(fileName);
+    fileTable->setItem(row, 0, fileItem);
+    fileTable->setItem(row, 1, new QTableWidgetItem(status));
+}
+
+void BatchEncryptionDialog::slotExecuteAction()
+{
+    if (mJob != 0 && mJob->isRunning()) {
+        return;
+    }
+
+    QStringList *uidList = mKeyList->getChecked();
+    if (uidList->isEmpty()) {
+        statusLabel->setText(tr("No Key Selected"));
+        return;
+    }
+
+    delete mJob;
+    mJob = new GpgBatchJob(mCtx, GpgBatchJob::EncryptFiles, this);
+    mJob->setKeys(*uidList);
+    mJob->setOverwrite(overwriteCheckBox->isChecked());
+
+    // directories are expanded by the job, show the files it found instead
+    for (int row = 0; row < fileTable->rowCount(); row++) {
+        mJob->addFile(fileTable->item(row, 0)->text());
+    }
+    fileTable->setRowCount(0);
+    for (int i = 0; i < mJob->count(); i++) {
+        addFileRow(mJob->result(i).inFileName, tr("Waiting"));
+    }
+
+    if (mJob->count() == 0) {
+        statusLabel->setText(tr("No files to encrypt"));
+        return;
+    }
+
+    connect(mJob, SIGNAL(signalFileFinished(int)), this, SLOT(slotFileFinished(int)));
+    connect(mJob, SIGNAL(signalFinished()), this, SLOT(slotJobFinished()));
+
+    statusLabel->clear();
+    progressBar->setRange(0, mJob->count());
+    progressBar->setValue(0);
+    setRunning(true);
+    mJob->start();
+}
+
+void BatchEncryptionDialog::slotFileFinished(int index)
+{
+    const GpgBatchResult &result = mJob->result(index);
+    QTableWidgetItem *statusItem = fileTable->item(index, 1);
+    if (result.success) {
+        statusItem->setText(tr("Encrypted to %1").arg(QFileInfo(result.outFileName).fileName()));
+        statusItem->setForeground(QBrush(Qt::darkGreen));
+    } else {
+        statusItem->setText(result.errorString);
+        statusItem->setForeground(QBrush(Qt::red));
+    }
+    statusItem->setToolTip(statusItem->text());
+    progressBar->setValue(mJob->finishedCount());
+}
+
+void BatchEncryptionDialog::slotJobFinished()
+{
+    setRunning(false);
+    if (mJob->failedCount() > 0) {
+        statusLabel->setText(tr("%1 of %2 files could not be encrypted")
+                             .arg(mJob->failedCount()).arg(mJob->count()));
+    } else {
+        QMessageBox::information(this, tr("Done"), tr("%1 files encrypted").arg(mJob->count()));
+    }
+}
+
+void BatchEncryptionDialog::setRunning(bool running)
+{
+    addFilesButton->setDisabled(running);
+    addDirectoryButton->setDisabled(running);
+    removeButton->setDisabled(running);
+    encryptButton->setDisabled(running);
+    overwriteCheckBox->setDisabled(running);
+    mKeyList->setDisabled(running);
+    buttonBox->button(QDialogButtonBox::Close)->setText(running ? tr("Cancel") : tr("Close"));
+}
+
+void BatchEncryptionDialog::reject()
+{
+    if (mJob != 0 && mJob->isRunning()) {
+        mJob->slotCancel();
+        return;
+    }
+    QDialog::reject();
+}
@@ -0,0 +1,103 @@
+/*
+ *      batchencryptiondialog.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __BATCHENCRYPTIONDIALOG_H__
+#define __BATCHENCRYPTIONDIALOG_H__
+
+#include "gpgbatchjob.h"
+#include "keylist.h"
+
+QT_BEGIN_NAMESPACE
+class QDialog;
+class QTableWidget;
+class QCheckBox;
+class QProgressBar;
+class QDialogButtonBox;
+class QPushButton;
+class QLabel;
+QT_END_NAMESPACE
+
+/**
+ * @brief Dialog for encrypting many files and directories for the same recipients.
+ * The files are encrypted in parallel by a GpgBatchJob, the result for every file
+ * is shown in the file table.
+ */
+class BatchEncryptionDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param ctx The GPGme-Context
+     * @param keyList The keyids, which should be checked in the keylist
+     * @param parent The parent widget
+     */
+    BatchEncryptionDialog(GpgME::GpgContext *ctx, QStringList keyList, QWidget *parent = 0);
+
+public slots:
+    /**
+     * @details Add files to the file table.
+     */
+    void slotAddFiles();
+
+    /**
+     * @details Add a directory to the file table, its files are added on encryption.
+     */
+    void slotAddDirectory();
+
+    /**
+     * @details Remove the selected entries from the file table.
+     */
+    void slotRemoveFiles();
+
+    /**
+     * @details Start the encryption of all files in the file table.
+     */
+    void slotExecuteAction();
+
+    /**
+     * @details Cancel a running encryption, or close the dialog.
+     */
+    void reject();
+
+private slots:
+    void slotFileFinished(int index);
+    void slotJobFinished();
+
+private:
+    void addFileRow(const QString &fileName, const QString &status);
+    void setRunning(bool running);
+
+    GpgME::GpgContext *mCtx;
+    KeyList *mKeyList;
+    GpgBatchJob *mJob;
+    QTableWidget *fileTable;
+    QCheckBox *overwriteCheckBox;
+    QProgressBar *progressBar;
+    QLabel *statusLabel;
+    QPushButton *addFilesButton;
+    QPushButton *addDirectoryButton;
+    QPushButton *removeButton;
+    QPushButton *encryptButton;
+    QDialogButtonBox *buttonBox;
+};
+
+#endif // __BATCHENCRYPTIONDIALOG_H__
@@ -0,0 +1,405 @@
+/*
+ *      batchmode.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "batchmode.h"
+#include "gpgserver.h"
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+BatchMode::BatchMode(const QStringList &arguments, QObject *parent)
+    : QObject(parent), mErr(stderr)
+{
+    mArguments = arguments;
+    mCtx = 0;
+    mOperation = None;
+    mForce = false;
+    mSocketName = "gpg4usb";
+}
+
+BatchMode::~BatchMode()
+{
+    GpgME::GpgContext::releaseKeys(&mRecipients);
+    delete mCtx;
+}
+
+bool BatchMode::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int BatchMode::exec()
+{
+    if (!parseArguments()) {
+        printUsage();
+        return 2;
+    }
+
+#ifdef _WIN32
+    // gpgme reads and writes binary data
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    mCtx = new GpgME::GpgContext();
+    mCtx->setShowErrorMessages(false);
+
+    if (!mPasswordFileName.isEmpty() && !readPassword()) {
+        return 2;
+    }
+
+    if (mOperation == Serve) {
+        GpgServer server(mCtx);
+        if (!server.listen(mSocketName)) {
+            report(mSocketName, server.errorString());
+            return 2;
+        }
+        report(mSocketName, tr("waiting for requests"));
+        mErr.flush();
+        return qApp->exec();
+    }
+
+    if (mOperation == Encrypt) {
+        QStringList uidList;
+        if (!findKeys(mRecipientNames, false, &uidList)) {
+            return 2;
+        }
+        mRecipients = mCtx->resolveKeys(&uidList);
+    } else if (mOperation == Sign) {
+        if (!findKeys(mSignerNames, true, &mSignerIds)) {
+            return 2;
+        }
+    }
+
+    int failed = 0;
+    foreach (QString inFileName, mInFileNames) {
+        if (!process(inFileName)) {
+            failed++;
+        }
+    }
+    mErr.flush();
+    return failed > 0 ? 1 : 0;
+}
+
+bool BatchMode::parseArguments()
+{
+    bool filesOnly = false;
+    for (int i = 0; i < mArguments.size(); i++) {
+        const QString &arg = mArguments.at(i);
+        Operation operation = None;
+
+        if (filesOnly || arg == "-" || !arg.startsWith("-")) {
+            mInFileNames.append(arg);
+            continue;
+        }
+
+        if (arg == "--") {
+            filesOnly = true;
+        } else if (arg == "--batch" || arg == "-d") {
+            // -d is the debug switch of GpgContext
+        } else if (arg == "--encrypt") {
+            operation = Encrypt;
+        } else if (arg == "--decrypt") {
+            operation = Decrypt;
+        } else if (arg == "--sign") {
+            operation = Sign;
+        } else if (arg == "--verify") {
+            operation = Verify;
+        } else if (arg == "--import") {
+            operation = Import;
+        } else if (arg == "--serve") {
+            operation = Serve;
+        } else if (arg == "--force") {
+            mForce = true;
+        } else if (i + 1 < mArguments.size()
+                   && (arg == "-r" || arg == "--recipient" || arg == "-u" || arg == "--local-user"
+                       || arg == "-o" || arg == "--output" || arg == "--password-file"
+                       || arg == "--socket")) {
+            const QString &value = mArguments.at(++i);
+            if (arg == "-r" || arg == "--recipient") {
+                mRecipientNames.append(value);
+            } else if (arg == "-u" || arg == "--local-user") {
+                mSignerNames.append(value);
+            } else if (arg == "-o" || arg == "--output") {
+                mOutFileName = value;
+            } else if (arg == "--socket") {
+                mSocketName = value;
+            } else {
+                mPasswordFileName = value;
+            }
+        } else {
+            mErr << tr("Unknown or incomplete option %1").arg(arg) << endl;
+            return false;
+        }
+
+        if (operation != None) {
+            if (mOperation != None) {
+                mErr << tr("Only one operation can be given") << endl;
+                return false;
+            }
+            mOperation = operation;
+        }
+    }
+
+    if (mOperation == None) {
+        return false;
+    }
+    if (mOperation == Serve) {
+        return true;
+    }
+    if (mInFileNames.isEmpty()) {
+        mInFileNames.append("-");
+    }
+    if (!mOutFileName.isEmpty() && mInFileNames.size() > 1) {
+        mErr << tr("--output can only be used with one input") << endl;
+        return false;
+    }
+    if (mOperation == Encrypt && mRecipientNames.isEmpty()) {
+        mErr << tr("--encrypt needs at least one --recipient") << endl;
+        return false;
+    }
+    if (mOperation == Sign && mSignerNames.isEmpty()) {
+        mErr << tr("--sign needs at least one --local-user") << endl;
+        return false;
+    }
+    return true;
+}
+
+void BatchMode::printUsage()
+{
+    mErr << tr("Usage: gpg4usb --batch OPERATION [OPTIONS] [FILE ...]") << endl
+         << endl
+         << tr("Operations:") << endl
+         << tr("  --encrypt       encrypt to FILE.asc") << endl
+         << tr("  --decrypt       decrypt FILE.asc to FILE, other files to FILE.out") << endl
+         << tr("  --sign          write a detached signature to FILE.sig") << endl
+         << tr("  --verify        verify FILE with FILE.sig, or a signed FILE") << endl
+         << tr("  --import        import the keys in FILE") << endl
+         << tr("  --serve         answer requests on a local socket until killed") << endl
+         << endl
+         << tr("Options:") << endl
+         << tr("  -r, --recipient KEY      encrypt for KEY (key id, fingerprint or email)") << endl
+         << tr("  -u, --local-user KEY     sign with KEY") << endl
+         << tr("  -o, --output FILE        output file for a single input, - for stdout") << endl
+         << tr("  --password-file FILE     read the password from the first line of FILE") << endl
+         << tr("  --force                  overwrite existing output files") << endl
+         << tr("  --socket NAME            socket name for --serve, default gpg4usb") << endl
+         << endl
+         << tr("Without FILE or with -, stdin is read and the output is written to stdout.") << endl;
+    mErr.flush();
+}
+
+bool BatchMode::readPassword()
+{
+    QFile file(mPasswordFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        report(mPasswordFileName, file.errorString());
+        return false;
+    }
+    QByteArray password = file.readLine();
+    while (password.endsWith('\n') || password.endsWith('\r')) {
+        password.chop(1);
+    }
+    mCtx->setPassword(password);
+    password.fill('\0');
+    return true;
+}
+
+/** Resolve the key names of the command line to key ids,
+ *  every name has to match exactly one key.
+ */
+bool BatchMode::findKeys(const QStringList &names, bool secret, QStringList *uidList)
+{
+    foreach (QString name, names) {
+        const GpgKey *key = mCtx->keyStore()->findByName(name, secret);
+        if (key == 0) {
+            report(name, secret ? tr("no secret key found") : tr("no key found"));
+            return false;
+        }
+        uidList->append(key->id);
+    }
+    return true;
+}
+
+bool BatchMode::process(const QString &inFileName)
+{
+    QFile inFile;
+    if (!openInput(&inFile, inFileName)) {
+        return false;
+    }
+    mCtx->clearLastError();
+
+    if (mOperation == Verify) {
+        return verify(&inFile, inFileName);
+    }
+    if (mOperation == Import) {
+        return import(&inFile, inFileName);
+    }
+
+    QString outFileName = mOutFileName.isEmpty() ? outFileNameFor(inFileName) : mOutFileName;
+    if (outFileName != "-" && !mForce && QFile::exists(outFileName)) {
+        report(inFileName, tr("%1 exists, use --force to overwrite it").arg(outFileName));
+        return false;
+    }
+    QFile outFile;
+    if (!openOutput(&outFile, outFileName)) {
+        return false;
+    }
+
+    bool success = false;
+    if (mOperation == Encrypt) {
+        success = mCtx->encryptFile(mRecipients.data(), &inFile, &outFile);
+    } else if (mOperation == Decrypt) {
+        success = mCtx->decryptFile(&inFile, &outFile);
+    } else if (mOperation == Sign) {
+        success = mCtx->signFile(&mSignerIds, &inFile, &outFile);
+    }
+
+    inFile.close();
+    outFile.close();
+
+    if (!success) {
+        // don't leave a partially written file behind
+        if (outFileName != "-") {
+            outFile.remove();
+        }
+        report(inFileName, mCtx->lastErrorString());
+    }
+    return success;
+}
+
+/** gpgme reads the file descriptor, so the files are opened unbuffered
+ */
+bool BatchMode::openInput(QFile *file, const QString &fileName)
+{
+    bool opened;
+    if (fileName == "-") {
+        opened = file->open(stdin, QIODevice::ReadOnly | QIODevice::Unbuffered);
+    } else {
+        file->setFileName(fileName);
+        opened = file->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+    if (!opened) {
+        report(fileName, file->errorString());
+    }
+    return opened;
+}
+
+bool BatchMode::openOutput(QFile *file, const QString &fileName)
+{
+    bool opened;
+    if (fileName == "-") {
+        opened = file->open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+    } else {
+        file->setFileName(fileName);
+        opened = file->open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+    }
+    if (!opened) {
+        report(fileName, file->errorString());
+    }
+    return opened;
+}
+
+/** The same names as in the file encryption dialog
+ */
+QString BatchMode::outFileNameFor(const QString &inFileName) const
+{
+    if (inFileName == "-") {
+        return inFileName;
+    }
+    if (mOperation == Encrypt) {
+        return inFileName + ".asc";
+    }
+    if (mOperation == Sign) {
+        return inFileName + ".sig";
+    }
+    if (inFileName.endsWith(".asc", Qt::CaseInsensitive)) {
+        return inFileName.left(inFileName.size() - 4);
+    }
+    return inFileName + ".out";
+}
+
+/** A file with a detached signature file.sig is streamed to gpg,
+ *  other input is verified as signed text in memory.
+ */
+bool BatchMode::verify(QFile *inFile, const QString &inFileName)
+{
+    GpgSignatureList signatures;
+    QFile sigFile(inFileName + ".sig");
+    if (inFileName != "-" && sigFile.exists()) {
+        if (!sigFile.open(QIODevice::ReadOnly)) {
+            report(sigFile.fileName(), sigFile.errorString());
+            return false;
+        }
+        signatures = mCtx->verifyFile(inFile, sigFile.readAll());
+    } else {
+        QByteArray text = inFile->readAll();
+        signatures = mCtx->verify(&text);
+    }
+
+    if (signatures.isEmpty()) {
+        QString error = mCtx->lastErrorString();
+        report(inFileName, error.isEmpty() ? tr("no signature found") : error);
+        return false;
+    }
+
+    bool success = true;
+    foreach (const GpgSignature &signature, signatures) {
+        GpgKey key = mCtx->getKeyByFpr(signature.fpr);
+        QString signer = key.fpr.isEmpty() ? signature.fpr
+                         : QString("%1 <%2> %3").arg(key.name, key.email, key.fpr);
+        if (signature.status == GPG_ERR_NO_ERROR) {
+            report(inFileName, tr("good signature from %1").arg(signer));
+        } else {
+            report(inFileName, tr("bad signature from %1: %2").arg(signer)
+                   .arg(GpgME::GpgContext::gpgErrString(signature.status)));
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool BatchMode::import(QFile *inFile, const QString &inFileName)
+{
+    // streamed, batch mode has no keylist to refresh
+    GpgImportInformation result = mCtx->importKeyFile(inFile);
+    if (result.considered == 0) {
+        QString error = mCtx->lastErrorString();
+        report(inFileName, error.isEmpty() ? tr("no keys found") : error);
+        return false;
+    }
+    report(inFileName, tr("%1 keys imported, %2 unchanged, %3 not imported")
+           .arg(result.imported).arg(result.unchanged).arg(result.not_imported));
+    return result.not_imported == 0;
+}
+
+void BatchMode::report(const QString &fileName, const QString &message)
+{
+    mErr << fileName << ": " << message << endl;
+}
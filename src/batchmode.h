@@ -0,0 +1,103 @@
+/*
+ *      batchmode.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __BATCHMODE_H__
+#define __BATCHMODE_H__
+
+#include "gpgcontext.h"
+#include <QTextStream>
+
+/**
+ * @brief Runs gpg4usb without gui, so scripts can use the portable keydb:
+ *
+ *     gpg4usb --batch --encrypt -r KEY [-r KEY ...] [-o FILE] [FILE ...]
+ *
+ * @details One context is used for all inputs, so the keydb is read and the
+ * recipients are resolved only once per process. The data is streamed by gpgme
+ * between the file descriptors, "-" or no file stands for stdin and stdout.
+ * Errors and results of --verify and --import are printed to stderr.
+ *
+ * With --serve, requests are read from a local socket instead, see GpgServer.
+ */
+class BatchMode : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Operation {
+        None,
+        Encrypt,
+        Decrypt,
+        Sign,
+        Verify,
+        Import,
+        Serve
+    };
+
+    /**
+     * @param arguments The command line arguments without the program name.
+     * @param parent The parent object.
+     */
+    BatchMode(const QStringList &arguments, QObject *parent = 0);
+    ~BatchMode();
+
+    /**
+     * @return true, if --batch is one of the arguments, has to be known
+     * before the application is created
+     */
+    static bool isRequested(int argc, char *argv[]);
+
+    /**
+     * @details Process all inputs.
+     *
+     * @return The exit code: 0 on success, 1 if an input failed, 2 on usage errors
+     */
+    int exec();
+
+private:
+    bool parseArguments();
+    void printUsage();
+    bool readPassword();
+    bool findKeys(const QStringList &names, bool secret, QStringList *uidList);
+    bool process(const QString &inFileName);
+    bool openInput(QFile *file, const QString &fileName);
+    bool openOutput(QFile *file, const QString &fileName);
+    QString outFileNameFor(const QString &inFileName) const;
+    bool verify(QFile *inFile, const QString &inFileName);
+    bool import(QFile *inFile, const QString &inFileName);
+    void report(const QString &fileName, const QString &message);
+
+    QStringList mArguments;
+    GpgME::GpgContext *mCtx;
+    Operation mOperation;
+    QStringList mInFileNames;
+    QString mOutFileName;
+    QStringList mRecipientNames;
+    QStringList mSignerNames;
+    QString mPasswordFileName;
+    QString mSocketName;
+    QVector<gpgme_key_t> mRecipients; /** resolved once for all inputs */
+    QStringList mSignerIds;
+    bool mForce;
+    QTextStream mErr;
+};
+
+#endif // __BATCHMODE_H__
@@ -0,0 +1,261 @@
+/*
+ *      batchverifydialog.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "batchverifydialog.h"
+
+BatchVerifyDialog::BatchVerifyDialog(GpgME::GpgContext *ctx, KeyList *keyList, QWidget *parent)
+    : QDialog(parent)
+{
+    mCtx = ctx;
+    mKeyList = keyList;
+    mJob = 0;
+
+    setWindowTitle(tr("Verify Multiple Files"));
+    resize(700, 600);
+    setModal(true);
+
+    /* Setup file table */
+    QGroupBox *fileBox = new QGroupBox(tr("Files"));
+    fileTable = new QTableWidget(0, 3);
+    fileTable->verticalHeader()->hide();
+    fileTable->setShowGrid(false);
+    fileTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    fileTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    fileTable->setAlternatingRowColors(true);
+    QStringList labels;
+    labels << tr("File") << tr("Signed by") << tr("Status");
+    fileTable->setHorizontalHeaderLabels(labels);
+    fileTable->setColumnWidth(0, 300);
+    fileTable->setColumnWidth(1, 150);
+    fileTable->horizontalHeader()->setStretchLastSection(true);
+    connect(fileTable, SIGNAL(itemSelectionChanged()), this, SLOT(slotShowDetails()));
+
+    addFilesButton = new QPushButton(tr("Add Files..."));
+    connect(addFilesButton, SIGNAL(clicked()), this, SLOT(slotAddFiles()));
+    addDirectoryButton = new QPushButton(tr("Add Directory..."));
+    connect(addDirectoryButton, SIGNAL(clicked()), this, SLOT(slotAddDirectory()));
+    removeButton = new QPushButton(tr("Remove"));
+    connect(removeButton, SIGNAL(clicked()), this, SLOT(slotRemoveFiles()));
+
+    QVBoxLayout *fileButtonLayout = new QVBoxLayout();
+    fileButtonLayout->addWidget(addFilesButton);
+    fileButtonLayout->addWidget(addDirectoryButton);
+    fileButtonLayout->addWidget(removeButton);
+    fileButtonLayout->addStretch(0);
+
+    QHBoxLayout *fileLayout = new QHBoxLayout();
+    fileLayout->addWidget(fileTable);
+    fileLayout->addLayout(fileButtonLayout);
+    fileBox->setLayout(fileLayout);
+
+    /* Signatures of the selected file */
+    QGroupBox *detailsBox = new QGroupBox(tr("Signatures"));
+    detailsArea = new QScrollArea();
+    detailsArea->setWidgetResizable(true);
+    QVBoxLayout *detailsLayout = new QVBoxLayout();
+    detailsLayout->addWidget(detailsArea);
+    detailsBox->setLayout(detailsLayout);
+
+    progressBar = new QProgressBar();
+    progressBar->setRange(0, 1);
+    progressBar->setValue(0);
+
+    statusLabel = new QLabel();
+    statusLabel->setStyleSheet("QLabel {color: red;}");
+
+    buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
+    verifyButton = buttonBox->addButton(tr("Verify"), QDialogButtonBox::AcceptRole);
+    connect(buttonBox, SIGNAL(accepted()), this, SLOT(slotExecuteAction()));
+    connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+    QVBoxLayout *vbox = new QVBoxLayout();
+    vbox->addWidget(fileBox, 2);
+    vbox->addWidget(detailsBox, 1);
+    vbox->addWidget(progressBar);
+    vbox->addWidget(statusLabel);
+    vbox->addWidget(buttonBox);
+    setLayout(vbox);
+
+    exec();
+}
+
+void BatchVerifyDialog::slotAddFiles()
+{
+    QStringList fileNames = QFileDialog::getOpenFileNames(this, tr("Open Files"));
+    if (!fileNames.isEmpty()) {
+        clearResults();
+    }
+    foreach (QString fileName, fileNames) {
+        addFileRow(fileName, "");
+    }
+}
+
+void BatchVerifyDialog::slotAddDirectory()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Open Directory"));
+    if (!dir.isEmpty()) {
+        clearResults();
+        addFileRow(dir, tr("Directory"));
+    }
+}
+
+void BatchVerifyDialog::slotRemoveFiles()
+{
+    QList<QTableWidgetSelectionRange> ranges = fileTable->selectedRanges();
+    clearResults();
+    // remove from bottom, to keep the row numbers of the other ranges valid
+    for (int i = ranges.size() - 1; i >= 0; i--) {
+        for (int row = ranges.at(i).bottomRow(); row >= ranges.at(i).topRow(); row--) {
+            fileTable->removeRow(row);
+        }
+    }
+}
+
+/** The results of the last run are found by the row of their file,
+ *  so they are dropped as soon as the rows change
+ */
+void BatchVerifyDialog::clearResults()
+{
+    delete mJob;
+    mJob = 0;
+    slotShowDetails();
+}
+
+void BatchVerifyDialog::addFileRow(const QString &fileName, const QString &status)
+{
+    int row = fileTable->rowCount();
+    fileTable->setRowCount(row + 1);
+    QTableWidgetItem *fileItem = new QTableWidgetItem(fileName);
+    fileItem->setToolTip(fileName);
+    fileTable->setItem(row, 0, fileItem);
+    fileTable->setItem(row, 1, new QTableWidgetItem());
+    fileTable->setItem(row, 2, new QTableWidgetItem(status));
+}
+
+void BatchVerifyDialog::slotExecuteAction()
+{
+    if (mJob != 0 && mJob->isRunning()) {
+        return;
+    }
+
+    delete mJob;
+    mJob = new GpgBatchJob(mCtx, GpgBatchJob::VerifyFiles, this);
+
+    // directories are expanded by the job, show the files it found instead
+    for (int row = 0; row < fileTable->rowCount(); row++) {
+        mJob->addFile(fileTable->item(row, 0)->text());
+    }
+    fileTable->setRowCount(0);
+    for (int i = 0; i < mJob->count(); i++) {
+        addFileRow(mJob->result(i).inFileName, tr("Waiting"));
+    }
+
+    if (mJob->count() == 0) {
+        statusLabel->setText(tr("No signed files to verify"));
+        return;
+    }
+
+    connect(mJob, SIGNAL(signalFileFinished(int)), this, SLOT(slotFileFinished(int)));
+    connect(mJob, SIGNAL(signalFinished()), this, SLOT(slotJobFinished()));
+
+    statusLabel->clear();
+    progressBar->setRange(0, mJob->count());
+    progressBar->setValue(0);
+    setRunning(true);
+    mJob->start();
+}
+
+void BatchVerifyDialog::slotFileFinished(int index)
+{
+    const GpgBatchResult &result = mJob->result(index);
+
+    QStringList signers;
+    foreach (const GpgSignature &signature, result.signatures) {
+        GpgKey key = mCtx->getKeyByFpr(signature.fpr);
+        signers << (key.name.isEmpty() ? signature.fpr : key.name);
+    }
+    QTableWidgetItem *signersItem = fileTable->item(index, 1);
+    signersItem->setText(signers.join(", "));
+    signersItem->setToolTip(signersItem->text());
+
+    QTableWidgetItem *statusItem = fileTable->item(index, 2);
+    if (result.success) {
+        statusItem->setText(tr("Valid signature"));
+        statusItem->setForeground(QBrush(Qt::darkGreen));
+    } else {
+        statusItem->setText(result.errorString);
+        statusItem->setForeground(QBrush(Qt::red));
+    }
+    statusItem->setToolTip(statusItem->text());
+    progressBar->setValue(mJob->finishedCount());
+
+    if (fileTable->currentRow() == index) {
+        slotShowDetails();
+    }
+}
+
+void BatchVerifyDialog::slotJobFinished()
+{
+    setRunning(false);
+    if (mJob->failedCount() > 0) {
+        statusLabel->setText(tr("%1 of %2 files could not be verified")
+                             .arg(mJob->failedCount()).arg(mJob->count()));
+    } else {
+        QMessageBox::information(this, tr("Done"), tr("%1 files verified").arg(mJob->count()));
+    }
+}
+
+/** Show the signatures of the selected file like VerifyDetailsDialog does
+ */
+void BatchVerifyDialog::slotShowDetails()
+{
+    QWidget *details = new QWidget();
+    QVBoxLayout *detailsLayout = new QVBoxLayout(details);
+
+    int row = fileTable->currentRow();
+    if (mJob != 0 && row >= 0 && row < mJob->count() && mJob->result(row).finished) {
+        foreach (const GpgSignature &signature, mJob->result(row).signatures) {
+            detailsLayout->addWidget(new VerifyKeyDetailBox(details, mCtx, mKeyList, signature));
+        }
+    }
+    detailsLayout->addStretch(0);
+
+    // the old widget is deleted by the scroll area
+    detailsArea->setWidget(details);
+}
+
+void BatchVerifyDialog::setRunning(bool running)
+{
+    addFilesButton->setDisabled(running);
+    addDirectoryButton->setDisabled(running);
+    removeButton->setDisabled(running);
+    verifyButton->setDisabled(running);
+    buttonBox->button(QDialogButtonBox::Close)->setText(running ? tr("Cancel") : tr("Close"));
+}
+
+void BatchVerifyDialog::reject()
+{
+    if (mJob != 0 && mJob->isRunning()) {
+        mJob->slotCancel();
+        return;
+    }
+    QDialog::reject();
+}
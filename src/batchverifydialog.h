@@ -0,0 +1,106 @@
+/*
+ *      batchverifydialog.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __BATCHVERIFYDIALOG_H__
+#define __BATCHVERIFYDIALOG_H__
+
+#include "gpgbatchjob.h"
+#include "keylist.h"
+#include "verifykeydetailbox.h"
+
+QT_BEGIN_NAMESPACE
+class QDialog;
+class QTableWidget;
+class QScrollArea;
+class QProgressBar;
+class QDialogButtonBox;
+class QPushButton;
+class QLabel;
+QT_END_NAMESPACE
+
+/**
+ * @brief Dialog for verifying many files with their detached signatures (file.sig).
+ * The files are verified in parallel by a GpgBatchJob, the result for every file
+ * is shown in the file table, the signatures of the selected file below it.
+ */
+class BatchVerifyDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param ctx The GPGme-Context
+     * @param keyList The keylist, to which keys of unknown signers can be imported
+     * @param parent The parent widget
+     */
+    BatchVerifyDialog(GpgME::GpgContext *ctx, KeyList *keyList, QWidget *parent = 0);
+
+public slots:
+    /**
+     * @details Add files or signatures to the file table.
+     */
+    void slotAddFiles();
+
+    /**
+     * @details Add a directory to the file table, its signed files are added on verifying.
+     */
+    void slotAddDirectory();
+
+    /**
+     * @details Remove the selected entries from the file table.
+     */
+    void slotRemoveFiles();
+
+    /**
+     * @details Start verifying all files in the file table.
+     */
+    void slotExecuteAction();
+
+    /**
+     * @details Cancel a running verification, or close the dialog.
+     */
+    void reject();
+
+private slots:
+    void slotFileFinished(int index);
+    void slotJobFinished();
+    void slotShowDetails();
+
+private:
+    void addFileRow(const QString &fileName, const QString &status);
+    void clearResults();
+    void setRunning(bool running);
+
+    GpgME::GpgContext *mCtx;
+    KeyList *mKeyList;
+    GpgBatchJob *mJob;
+    QTableWidget *fileTable;
+    QScrollArea *detailsArea;
+    QProgressBar *progressBar;
+    QLabel *statusLabel;
+    QPushButton *addFilesButton;
+    QPushButton *addDirectoryButton;
+    QPushButton *removeButton;
+    QPushButton *verifyButton;
+    QDialogButtonBox *buttonBox;
+};
+
+#endif // __BATCHVERIFYDIALOG_H__
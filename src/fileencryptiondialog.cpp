@@ -177,26 +177,13 @@ void FileEncryptionDialog::slotExecuteAction()
 
     QFile infile;
     infile.setFileName(inputFileEdit->text());
-    if (!infile.open(QIODevice::ReadOnly)) {
+    if (!infile.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
         statusLabel->setText( tr("Couldn't open file"));
         inputFileEdit->setStyleSheet("QLineEdit { background: yellow }");
         return;
     }
 
-    QByteArray inBuffer = infile.readAll();
-    QByteArray *outBuffer = new QByteArray();
     infile.close();
-    if ( mAction == Encrypt ) {
-        if (! mCtx->encrypt(mKeyList->getChecked(), inBuffer, outBuffer)) return;
-    }
-
-    if ( mAction == Decrypt )  {
-        if (! mCtx->decrypt(inBuffer, outBuffer)) return;
-    }
-
-    if( mAction == Sign ) {
-        if(! mCtx->sign(mKeyList->getChecked(), inBuffer, outBuffer, true)) return;
-    }
 
     if( mAction == Verify ) {
         QFile signfile;
@@ -206,8 +193,14 @@ void FileEncryptionDialog::slotExecuteAction()
             signFileEdit->setStyleSheet("QLineEdit { background: yellow }");
             return;
         }
-        QByteArray signBuffer = signfile.readAll();
-        new VerifyDetailsDialog(this, mCtx, mKeyList, &inBuffer, &signBuffer);
+        signfile.close();
+
+        // the file is streamed to gpg, so even huge files can be verified
+        GpgJob *job = new GpgJob(mCtx, GpgJob::VerifyFile, this);
+        job->setSignedFiles(inputFileEdit->text(), signFileEdit->text());
+        new JobProgressDialog(job, tr("Verifying file..."), this);
+        connect(job, SIGNAL(finished()), this, SLOT(slotJobFinished()));
+        job->start();
         return;
     }
 
@@ -222,18 +215,52 @@ void FileEncryptionDialog::slotExecuteAction()
         }
     }
 
-    if (!outfile.open(QFile::WriteOnly)) {
-        QMessageBox::warning(this, tr("File"),
-                             tr("Cannot write file %1:\n%2.")
-                             .arg(outputFileEdit->text())
-                             .arg(outfile.errorString()));
+    GpgJob *job = 0;
+    if ( mAction == Encrypt ) {
+        job = new GpgJob(mCtx, GpgJob::EncryptFile, this);
+        job->setKeys(*mKeyList->getChecked());
+        new JobProgressDialog(job, tr("Encrypting file..."), this);
+    }
+
+    if ( mAction == Decrypt )  {
+        job = new GpgJob(mCtx, GpgJob::DecryptFile, this);
+        new JobProgressDialog(job, tr("Decrypting file..."), this);
+    }
+
+    if( mAction == Sign ) {
+        job = new GpgJob(mCtx, GpgJob::SignFile, this);
+        job->setKeys(*mKeyList->getChecked());
+        new JobProgressDialog(job, tr("Signing file..."), this);
+    }
+
+    job->setFiles(inputFileEdit->text(), outputFileEdit->text());
+    connect(job, SIGNAL(finished()), this, SLOT(slotJobFinished()));
+    job->start();
+}
+
+void FileEncryptionDialog::slotJobFinished()
+{
+    GpgJob *job = qobject_cast<GpgJob *>(sender());
+    job->deleteLater();
+
+    if (job->operation() == GpgJob::VerifyFile) {
+        if (!job->errorString().isEmpty()) {
+            QMessageBox::warning(this, tr("File"), job->errorString());
+        } else if (!job->isCanceled()) {
+            new VerifyDetailsDialog(this, mCtx, mKeyList, job->signatures(),
+                                    job->inFileName(), job->sigFileName());
+        }
+        return;
+    }
+
+    if (!job->isSuccessful()) {
+        if (!job->errorString().isEmpty()) {
+            QMessageBox::warning(this, tr("File"), job->errorString());
+        }
         return;
     }
 
-    QDataStream out(&outfile);
-    out.writeRawData(outBuffer->data(), outBuffer->length());
-    outfile.close();
-    QMessageBox::information(0, "Done", "Output saved to " + outputFileEdit->text());
+    QMessageBox::information(0, "Done", "Output saved to " + job->outFileName());
 
     accept();
 }
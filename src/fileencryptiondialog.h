@@ -25,6 +25,7 @@
 #include "gpgcontext.h"
 #include "keylist.h"
 #include "verifydetailsdialog.h"
+#include "jobprogressdialog.h"
 
 QT_BEGIN_NAMESPACE
 class QDialog;
@@ -91,6 +92,12 @@ public slots:
      * @fn executeAction
      */
     void slotExecuteAction();
+    /**
+     * @brief
+     *
+     * @fn jobFinished
+     */
+    void slotJobFinished();
     /**
      * @brief
      *
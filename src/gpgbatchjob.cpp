@@ -0,0 +1,290 @@
+/*
+ *      gpgbatchjob.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "gpgbatchjob.h"
+
+GpgBatchJob::GpgBatchJob(GpgME::GpgContext *ctx, Operation operation, QObject *parent)
+    : QObject(parent)
+{
+    mCtx = ctx;
+    mOperation = operation;
+    mFinishedCount = 0;
+    mFailedCount = 0;
+    mOverwrite = false;
+    mRunning = false;
+    mCanceled = false;
+
+    qRegisterMetaType<GpgSignatureList>("GpgSignatureList");
+
+    // gpg runs as own process, so one thread per core keeps all cores busy
+    mThreadPool.setMaxThreadCount(QThread::idealThreadCount());
+    mPool = new GpgContextPool(mCtx, mThreadPool.maxThreadCount());
+    // errors are shown in the result list, not as one messagebox per file
+    mPool->setShowErrorMessages(false);
+}
+
+GpgBatchJob::~GpgBatchJob()
+{
+    slotCancel();
+    mThreadPool.waitForDone();
+    GpgME::GpgContext::releaseKeys(&mRecipients);
+    delete mPool;
+}
+
+void GpgBatchJob::setKeys(const QStringList &uidList)
+{
+    mUidList = uidList;
+}
+
+void GpgBatchJob::setOverwrite(bool overwrite)
+{
+    mOverwrite = overwrite;
+}
+
+void GpgBatchJob::addFile(const QString &fileName)
+{
+    QFileInfo info(fileName);
+    if (info.isDir()) {
+        QDirIterator it(fileName, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            QString file = it.next();
+            // don't encrypt the results of an earlier run again
+            if (mOperation == EncryptFiles && file.endsWith(".asc", Qt::CaseInsensitive)) {
+                continue;
+            }
+            // every pair is added once, by its signature
+            if (mOperation == VerifyFiles && !file.endsWith(".sig", Qt::CaseInsensitive)) {
+                continue;
+            }
+            addFile(file);
+        }
+        return;
+    }
+
+    GpgBatchResult result;
+    result.inFileName = info.absoluteFilePath();
+    if (mOperation == VerifyFiles && result.inFileName.endsWith(".sig", Qt::CaseInsensitive)) {
+        result.inFileName.chop(4);
+    }
+    result.outFileName = outFileNameFor(result.inFileName);
+    mResults.append(result);
+}
+
+QString GpgBatchJob::outFileNameFor(const QString &inFileName) const
+{
+    if (mOperation == VerifyFiles) {
+        return inFileName + ".sig";
+    }
+    return inFileName + ".asc";
+}
+
+int GpgBatchJob::count() const
+{
+    return mResults.size();
+}
+
+int GpgBatchJob::finishedCount() const
+{
+    return mFinishedCount;
+}
+
+int GpgBatchJob::failedCount() const
+{
+    return mFailedCount;
+}
+
+const GpgBatchResult &GpgBatchJob::result(int index) const
+{
+    return mResults.at(index);
+}
+
+bool GpgBatchJob::isRunning() const
+{
+    return mRunning;
+}
+
+void GpgBatchJob::start()
+{
+    if (mResults.isEmpty()) {
+        emit signalFinished();
+        return;
+    }
+
+    mRunning = true;
+    if (mOperation == EncryptFiles) {
+        mRecipients = mCtx->resolveKeys(&mUidList);
+        // the recipients are terminated by NULL, a missing key would silently
+        // drop all following recipients, or encrypt symmetrically if it is the first
+        int missing = mRecipients.indexOf(NULL);
+        if (missing < mUidList.size()) {
+            QString errorString = tr("No key found for %1").arg(mUidList.at(missing));
+            GpgME::GpgContext::releaseKeys(&mRecipients);
+            for (int i = 0; i < mResults.size(); i++) {
+                slotTaskFinished(i, false, errorString, GpgSignatureList());
+            }
+            return;
+        }
+    }
+
+    for (int i = 0; i < mResults.size(); i++) {
+        mThreadPool.start(new GpgBatchTask(this, i, mResults.at(i).inFileName,
+                                           mResults.at(i).outFileName));
+    }
+}
+
+void GpgBatchJob::slotCancel()
+{
+    mCanceled = true;
+    mPool->cancelAll();
+}
+
+/** Called in a thread of the threadpool, the result is passed
+ *  to the thread of the job by a queued call of slotTaskFinished
+ */
+void GpgBatchJob::runTask(int index, const QString &inFileName, const QString &outFileName)
+{
+    bool success = false;
+    QString errorString;
+    GpgSignatureList signatures;
+
+    if (mCanceled) {
+        errorString = tr("Canceled");
+    } else if (mOperation == EncryptFiles && !mOverwrite && QFile::exists(outFileName)) {
+        errorString = tr("Output file %1 exists").arg(outFileName);
+    } else {
+        GpgME::GpgContext *ctx = mPool->acquire();
+        ctx->clearLastError();
+        if (mOperation == EncryptFiles) {
+            success = encryptFile(ctx, inFileName, outFileName, &errorString);
+        } else if (mOperation == VerifyFiles) {
+            success = verifyFile(ctx, inFileName, outFileName, &signatures, &errorString);
+        }
+        mPool->release(ctx);
+
+        if (mCanceled && !success) {
+            errorString = tr("Canceled");
+        }
+    }
+
+    QMetaObject::invokeMethod(this, "slotTaskFinished", Qt::QueuedConnection,
+                              Q_ARG(int, index), Q_ARG(bool, success),
+                              Q_ARG(QString, errorString),
+                              Q_ARG(GpgSignatureList, signatures));
+}
+
+bool GpgBatchJob::encryptFile(GpgME::GpgContext *ctx, const QString &inFileName,
+                              const QString &outFileName, QString *errorString)
+{
+    QFile inFile(inFileName);
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        *errorString = inFile.errorString();
+        return false;
+    }
+
+    QFile outFile(outFileName);
+    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        *errorString = outFile.errorString();
+        return false;
+    }
+
+    bool success = ctx->encryptFile(mRecipients.data(), &inFile, &outFile);
+    inFile.close();
+    outFile.close();
+
+    // don't leave a partially written file behind
+    if (!success) {
+        *errorString = ctx->lastErrorString();
+        outFile.remove();
+    }
+    return success;
+}
+
+/** Only the detached signature is read into memory, the signed file is
+ *  streamed. Successful only, if all signatures are valid.
+ */
+bool GpgBatchJob::verifyFile(GpgME::GpgContext *ctx, const QString &inFileName, const QString &sigFileName,
+                             GpgSignatureList *signatures, QString *errorString)
+{
+    QFile sigFile(sigFileName);
+    if (!sigFile.open(QIODevice::ReadOnly)) {
+        *errorString = sigFile.errorString();
+        return false;
+    }
+    QByteArray sigBuffer = sigFile.readAll();
+    sigFile.close();
+
+    QFile inFile(inFileName);
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        *errorString = inFile.errorString();
+        return false;
+    }
+
+    *signatures = ctx->verifyFile(&inFile, sigBuffer);
+    inFile.close();
+
+    if (signatures->isEmpty()) {
+        *errorString = ctx->lastErrorString();
+        if (errorString->isEmpty()) {
+            *errorString = tr("No signature found");
+        }
+        return false;
+    }
+    foreach (const GpgSignature &signature, *signatures) {
+        if (gpg_err_code(signature.status) != GPG_ERR_NO_ERROR) {
+            *errorString = GpgME::GpgContext::gpgErrString(signature.status);
+            return false;
+        }
+    }
+    return true;
+}
+
+void GpgBatchJob::slotTaskFinished(int index, bool success, QString errorString, GpgSignatureList signatures)
+{
+    GpgBatchResult &result = mResults[index];
+    result.finished = true;
+    result.success = success;
+    result.errorString = errorString;
+    result.signatures = signatures;
+
+    mFinishedCount++;
+    if (!success) {
+        mFailedCount++;
+    }
+    emit signalFileFinished(index);
+
+    if (mFinishedCount == mResults.size()) {
+        mRunning = false;
+        emit signalFinished();
+    }
+}
+
+GpgBatchTask::GpgBatchTask(GpgBatchJob *job, int index, const QString &inFileName, const QString &outFileName)
+{
+    mJob = job;
+    mIndex = index;
+    mInFileName = inFileName;
+    mOutFileName = outFileName;
+}
+
+void GpgBatchTask::run()
+{
+    mJob->runTask(mIndex, mInFileName, mOutFileName);
+}
@@ -0,0 +1,158 @@
+/*
+ *      gpgbatchjob.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __GPGBATCHJOB_H__
+#define __GPGBATCHJOB_H__
+
+#include "gpgcontextpool.h"
+#include <QRunnable>
+#include <QThreadPool>
+
+/**
+ * @brief Result of the operation on a single file of a GpgBatchJob
+ */
+class GpgBatchResult
+{
+public:
+    GpgBatchResult() {
+        finished = false;
+        success = false;
+    }
+
+    QString inFileName;
+    QString outFileName; /** the output file, or the detached signature for VerifyFiles */
+    bool finished;
+    bool success;
+    QString errorString;
+    GpgSignatureList signatures; /** the signatures found by VerifyFiles */
+};
+
+Q_DECLARE_METATYPE(GpgSignatureList)
+
+/**
+ * @brief Runs an operation on many files in parallel. The files are processed
+ * by a QThreadPool, every thread uses a worker context of a GpgContextPool.
+ *
+ * The recipients are resolved only once in start(), and shared by all threads.
+ */
+class GpgBatchJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Operation {
+        EncryptFiles,
+        VerifyFiles
+    };
+
+    GpgBatchJob(GpgME::GpgContext *ctx, Operation operation, QObject *parent = 0);
+    ~GpgBatchJob();
+
+    /**
+     * @details Set the keys to encrypt for.
+     */
+    void setKeys(const QStringList &uidList);
+
+    /**
+     * @details If overwrite is false (the default), files with an existing
+     * output file are skipped.
+     */
+    void setOverwrite(bool overwrite);
+
+    /**
+     * @details Add a file, or all files in a directory and its subdirectories.
+     * Has to be called before start().
+     *
+     * For VerifyFiles, a file is paired with its detached signature file.sig,
+     * either of both may be given. In directories, only the files with a
+     * signature are added.
+     */
+    void addFile(const QString &fileName);
+
+    int count() const;
+    int finishedCount() const;
+    int failedCount() const;
+    const GpgBatchResult &result(int index) const;
+    bool isRunning() const;
+
+    /**
+     * @details Start processing all files, returns immediately. If a key set
+     * with setKeys() is not found, all files fail without being processed.
+     */
+    void start();
+
+public slots:
+    void slotCancel();
+
+signals:
+    /**
+     * @details Emitted when the file with index is processed, see result().
+     */
+    void signalFileFinished(int index);
+
+    /**
+     * @details Emitted when all files are processed.
+     */
+    void signalFinished();
+
+private slots:
+    void slotTaskFinished(int index, bool success, QString errorString, GpgSignatureList signatures);
+
+private:
+    friend class GpgBatchTask;
+    void runTask(int index, const QString &inFileName, const QString &outFileName);
+    bool encryptFile(GpgME::GpgContext *ctx, const QString &inFileName,
+                     const QString &outFileName, QString *errorString);
+    bool verifyFile(GpgME::GpgContext *ctx, const QString &inFileName, const QString &sigFileName,
+                    GpgSignatureList *signatures, QString *errorString);
+    QString outFileNameFor(const QString &inFileName) const;
+
+    GpgME::GpgContext *mCtx;
+    Operation mOperation;
+    GpgContextPool *mPool;
+    QThreadPool mThreadPool;
+    QStringList mUidList;
+    QVector<gpgme_key_t> mRecipients;
+    QVector<GpgBatchResult> mResults;
+    int mFinishedCount;
+    int mFailedCount;
+    bool mOverwrite;
+    bool mRunning;
+    volatile bool mCanceled;
+};
+
+/**
+ * @brief Processes one file of a GpgBatchJob in a thread of its QThreadPool.
+ */
+class GpgBatchTask : public QRunnable
+{
+public:
+    GpgBatchTask(GpgBatchJob *job, int index, const QString &inFileName, const QString &outFileName);
+    void run();
+
+private:
+    GpgBatchJob *mJob;
+    int mIndex;
+    QString mInFileName;
+    QString mOutFileName;
+};
+
+#endif // __GPGBATCHJOB_H__
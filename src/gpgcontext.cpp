@@ -32,6 +32,19 @@ namespace GpgME
  */
 GpgContext::GpgContext()
 {
+    mGuiCtx = 0;
+    mProgressPermille = -1;
+    mKeySearchIndex = 0;
+    mKeyCache = new GpgKeyCache();
+    mKeyDBReset = false;
+
+    /** a burst of changes, e.g. importing many keys one by one, is applied at once */
+    mKeyDBChangedTimer = new QTimer(this);
+    mKeyDBChangedTimer->setSingleShot(true);
+    mKeyDBChangedTimer->setInterval(keyDBChangedDelay);
+    connect(mKeyDBChangedTimer, SIGNAL(timeout()), this, SLOT(slotFlushKeyDBChanged()));
+    mShowErrorMessages = true;
+
     /** get application path */
     QString appPath = qApp->applicationDirPath();
 
@@ -56,9 +69,6 @@ GpgContext::GpgContext()
     gpgme_set_locale(NULL, LC_MESSAGES, setlocale(LC_MESSAGES, NULL));
 #endif
 
-    err = gpgme_new(&mCtx);
-
-    checkErr(err);
     /** here come the settings, instead of /usr/bin/gpg
      * a executable in the same path as app is used.
      * also lin/win must  be checked, for calling gpg.exe if needed
@@ -71,24 +81,28 @@ GpgContext::GpgContext()
 
     QSettings settings;
     QString accKeydbPath = settings.value("gpgpaths/keydbpath").toString();
-    QString gpgKeys = appPath + "/keydb/"+accKeydbPath;
+    gpgKeys = appPath + "/keydb/"+accKeydbPath;
 
     if (accKeydbPath != "") {
         if (!QDir(gpgKeys).exists()) {
-            QMessageBox::critical(0,tr("keydb path"),tr("Didn't find keydb directory. Switching to gpg4usb's default keydb directory for this session."));
+            if (QApplication::type() == QApplication::Tty) {
+                qWarning() << "Didn't find keydb directory, using the default keydb directory.";
+            } else {
+                QMessageBox::critical(0,tr("keydb path"),tr("Didn't find keydb directory. Switching to gpg4usb's default keydb directory for this session."));
+            }
             gpgKeys = appPath + "/keydb";
         }
     }
 
-    /*    err = gpgme_ctx_set_engine_info(mCtx, GPGME_PROTOCOL_OpenPGP,
-                                        gpgBin.toUtf8().constData(),
-                                        gpgKeys.toUtf8().constData());*/
-#ifndef GPG4USB_NON_PORTABLE
-    err = gpgme_ctx_set_engine_info(mCtx, GPGME_PROTOCOL_OpenPGP,
-                                    gpgBin.toLocal8Bit().constData(),
-                                    gpgKeys.toLocal8Bit().constData());
-    checkErr(err);
-#endif
+    /** check if app is called with -d from command line */
+    if (qApp->arguments().contains("-d")) {
+        qDebug() << "gpgme_data_t debug on";
+        debug = true;
+    } else {
+        debug = false;
+    }
+
+    createContext();
 
     gpgme_engine_info_t engineInfo;
     engineInfo = gpgme_ctx_get_engine_info(mCtx);
@@ -99,22 +113,55 @@ GpgContext::GpgContext()
         engineInfo=engineInfo->next;
     }
 
+    mKeyStore.sync(listKeys());
+}
+
+/** Constructor for worker contexts
+ *  Set up an own gpgme-context with the engine settings of guiCtx, which
+ *  may be used from another thread. Passphrase requests and error messages
+ *  are passed on to guiCtx, which lives in the gui thread.
+ */
+GpgContext::GpgContext(GpgContext *guiCtx)
+{
+    mGuiCtx = guiCtx;
+    mProgressPermille = -1;
+    mKeySearchIndex = 0;
+    mKeyDBChangedTimer = 0;
+    mKeyDBReset = false;
+    mKeyCache = guiCtx->mKeyCache;
+    mShowErrorMessages = true;
+    gpgBin = guiCtx->gpgBin;
+    gpgKeys = guiCtx->gpgKeys;
+    debug = guiCtx->debug;
+
+    createContext();
+
+    /** only worker contexts report progress, see GpgJob */
+    gpgme_set_progress_cb(mCtx, progressCb, this);
+}
+
+/** Create the gpgme-context and apply the engine settings
+ */
+void GpgContext::createContext()
+{
+    err = gpgme_new(&mCtx);
+    checkErr(err);
+
+    /*    err = gpgme_ctx_set_engine_info(mCtx, GPGME_PROTOCOL_OpenPGP,
+                                        gpgBin.toUtf8().constData(),
+                                        gpgKeys.toUtf8().constData());*/
+#ifndef GPG4USB_NON_PORTABLE
+    err = gpgme_ctx_set_engine_info(mCtx, GPGME_PROTOCOL_OpenPGP,
+                                    gpgBin.toLocal8Bit().constData(),
+                                    gpgKeys.toLocal8Bit().constData());
+    checkErr(err);
+#endif
+
     /** Setting the output type must be done at the beginning */
     /** think this means ascii-armor --> ? */
     gpgme_set_armor(mCtx, 1);
     /** passphrase-callback */
     gpgme_set_passphrase_cb(mCtx, passphraseCb, this);
-
-    /** check if app is called with -d from command line */
-    if (qApp->arguments().contains("-d")) {
-        qDebug() << "gpgme_data_t debug on";
-        debug = true;
-    } else {
-        debug = false;
-    }
-
-    connect(this,SIGNAL(signalKeyDBChanged()),this,SLOT(slotRefreshKeyList()));
-    slotRefreshKeyList();
 }
 
 /** Destructor
@@ -124,6 +171,19 @@ GpgContext::~GpgContext()
 {
     if (mCtx) gpgme_release(mCtx);
     mCtx = 0;
+    if (mGuiCtx == 0) {
+        delete mKeyCache;
+    }
+}
+
+/** Cancel the operation currently running in this context,
+ *  may be called from any thread.
+ */
+void GpgContext::cancel()
+{
+    if (mCtx) {
+        gpgme_cancel_async(mCtx);
+    }
 }
 
 /** Import Key from QByteArray
@@ -131,67 +191,118 @@ GpgContext::~GpgContext()
  */
 GpgImportInformation GpgContext::importKey(QByteArray inBuffer)
 {
-    GpgImportInformation *importInformation = new GpgImportInformation();
-    err = gpgme_data_new_from_mem(&in, inBuffer.data(), inBuffer.size(), 1);
-    checkErr(err);
-    err = gpgme_op_import(mCtx, in);
-    gpgme_import_result_t result;
-
-    result = gpgme_op_import_result(mCtx);
-    if (result->unchanged){
-        importInformation->unchanged = result->unchanged;
-    }
-    if (result->considered){
-        importInformation->considered = result->considered;
-    }
-    if (result->no_user_id){
-        importInformation->no_user_id = result->no_user_id;
-    }
-    if (result->imported){
-        importInformation->imported = result->imported;
-    }
-    if (result->imported_rsa){
-        importInformation->imported_rsa = result->imported_rsa;
-    }
-    if (result->unchanged){
-        importInformation->unchanged = result->unchanged;
-    }
-    if (result->new_user_ids){
-        importInformation->new_user_ids = result->new_user_ids;
-    }
-    if (result->new_sub_keys){
-        importInformation->new_sub_keys = result->new_sub_keys;
-    }
-    if (result->new_signatures){
-        importInformation->new_signatures = result->new_signatures;
-    }
-    if (result->new_revocations){
-        importInformation->new_revocations  =result->new_revocations;
-    }
-    if (result->secret_read){
-        importInformation->secret_read = result->secret_read;
+    GpgData in(inBuffer);
+    err = in.error();
+    if (checkErr(err)) {
+        return GpgImportInformation();
     }
-    if (result->secret_imported){
-        importInformation->secret_imported = result->secret_imported;
+    GpgImportInformation importInformation = importData(in.data());
+    QStringList fprs = importInformation.changedFingerprints();
+    if (!fprs.isEmpty()) {
+        notifyKeyDBChanged(fprs);
     }
-    if (result->secret_unchanged){
-        importInformation->secret_unchanged = result->secret_unchanged;
+    return importInformation;
+}
+
+/** Import Keys from a file, which is read while gpgme imports
+ *
+ */
+GpgImportInformation GpgContext::importKeyFile(QFile *inFile)
+{
+    GpgData in(inFile);
+    err = in.error();
+    if (checkErr(err)) {
+        return GpgImportInformation();
     }
-    if (result->not_imported){
-        importInformation->not_imported = result->not_imported;
+    mProgressPermille = -1;
+    in.setProgressCallback(dataProgressCb, this);
+    return importData(in.data());
+}
+
+GpgImportInformation GpgContext::importData(gpgme_data_t in)
+{
+    GpgImportInformation importInformation;
+    err = gpgme_op_import(mCtx, in);
+    checkErr(err);
+
+    gpgme_import_result_t result = gpgme_op_import_result(mCtx);
+    if (result == NULL) {
+        return importInformation;
     }
+    importInformation.considered = result->considered;
+    importInformation.no_user_id = result->no_user_id;
+    importInformation.imported = result->imported;
+    importInformation.imported_rsa = result->imported_rsa;
+    importInformation.unchanged = result->unchanged;
+    importInformation.new_user_ids = result->new_user_ids;
+    importInformation.new_sub_keys = result->new_sub_keys;
+    importInformation.new_signatures = result->new_signatures;
+    importInformation.new_revocations = result->new_revocations;
+    importInformation.secret_read = result->secret_read;
+    importInformation.secret_imported = result->secret_imported;
+    importInformation.secret_unchanged = result->secret_unchanged;
+    importInformation.not_imported = result->not_imported;
     gpgme_import_status_t status = result->imports;
     while (status != NULL) {
         GpgImportedKey key;
         key.importStatus = status->status;
         key.fpr = status->fpr;
-        importInformation->importedKeys.append(key);
-        status=status->next;
+        importInformation.importedKeys.append(key);
+        status = status->next;
     }
-    checkErr(err);
-    emit signalKeyDBChanged();
-    gpgme_data_release(in);
-    return *importInformation;
+    return importInformation;
+}
+
+/** Worker contexts share the keystore of the gui context, so let it
+ *  collect the changes. The timer has to be started in the gui thread.
+ */
+void GpgContext::notifyKeyDBChanged(const QStringList &fprs)
+{
+    if (mGuiCtx || QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(mGuiCtx ? mGuiCtx : this, "notifyKeyDBChanged",
+                                  Qt::QueuedConnection, Q_ARG(QStringList, fprs));
+        return;
+    }
+    if (fprs.isEmpty()) {
+        mKeyDBReset = true;
+    }
+    foreach (const QString &fpr, fprs) {
+        mChangedFprs.insert(fpr);
+    }
+    // restarted by every change, so a burst is applied once
+    mKeyDBChangedTimer->start();
+}
+
+/** Only the changed keys are listed and updated in the keystore,
+ *  unless the whole keyring changed or too many keys for one
+ *  gpg command line.
+ */
+void GpgContext::slotFlushKeyDBChanged()
+{
+    if (mGuiCtx || (!mKeyDBReset && mChangedFprs.isEmpty())) {
+        return;
+    }
+    mKeyDBChangedTimer->stop();
+    mKeyCache->clear();
+
+    QStringList fprs;
+    if (mKeyDBReset || mChangedFprs.size() > maxIncrementalKeys) {
+        mKeyStore.sync(listKeys());
+    } else {
+        fprs = mChangedFprs.toList();
+        QSet<QString> deleted = mChangedFprs;
+        foreach (const GpgKey &key, listKeys(fprs)) {
+            mKeyStore.insert(key);
+            deleted.remove(key.fpr);
+        }
+        foreach (const QString &fpr, deleted) {
+            mKeyStore.remove(fpr);
+        }
+    }
+    mKeyDBReset = false;
+    mChangedFprs.clear();
+
+    emit signalKeyDBChanged(fprs);
 }
 
 /** Generate New Key with values params
@@ -200,8 +311,15 @@ GpgImportInformation GpgContext::importKey(QByteArray inBuffer)
 void GpgContext::generateKey(QString *params)
 {
     err = gpgme_op_genkey(mCtx, params->toAscii().data(), NULL, NULL);
-    checkErr(err);
-    emit signalKeyDBChanged();
+    if (checkErr(err)) {
+        return;
+    }
+    gpgme_genkey_result_t result = gpgme_op_genkey_result(mCtx);
+    QStringList fprs;
+    if (result != NULL && result->fpr != NULL) {
+        fprs.append(QString::fromAscii(result->fpr));
+    }
+    notifyKeyDBChanged(fprs);
 }
 
 /** Export Key to QByteArray
@@ -209,27 +327,21 @@ void GpgContext::generateKey(QString *params)
  */
 bool GpgContext::exportKeys(QStringList *uidList, QByteArray *outBuffer)
 {
-    size_t read_bytes;
-    gpgme_data_t out = 0;
     outBuffer->resize(0);
 
     if (uidList->count() == 0) {
-        QMessageBox::critical(0, "Export Keys Error", "No Keys Selected");
+        showCriticalMessage("Export Keys Error", "No Keys Selected");
         return false;
     }
 
     for (int i = 0; i < uidList->count(); i++) {
-        err = gpgme_data_new(&out);
-        checkErr(err);
-
-        err = gpgme_op_export(mCtx, uidList->at(i).toAscii().constData(), 0, out);
+        // every key is appended to outBuffer
+        GpgData out(outBuffer);
+        err = out.error();
         checkErr(err);
 
-        read_bytes = gpgme_data_seek(out, 0, SEEK_END);
-
-        err = readToBuffer(out, outBuffer);
+        err = gpgme_op_export(mCtx, uidList->at(i).toAscii().constData(), 0, out.data());
         checkErr(err);
-        gpgme_data_release(out);
     }
     return true;
 }
@@ -250,25 +362,58 @@ gpgme_key_t GpgContext::getKeyDetails(QString uid)
 /** List all availabe Keys (VERY much like kgpgme)
  */
 GpgKeyList GpgContext::listKeys()
+{
+    return listKeys(QStringList());
+}
+
+/** List the keys matching patterns, all keys if patterns is empty.
+ *  The secret keys are listed first and looked up by id while
+ *  listing the public keys, so every key is touched only once
+ */
+GpgKeyList GpgContext::listKeys(const QStringList &patterns)
 {
     gpgme_error_t err;
     gpgme_key_t key;
 
+    // gpgme takes a NULL terminated array, NULL lists all keys
+    QList<QByteArray> patternData;
+    QVector<const char *> patternList;
+    foreach (const QString &pattern, patterns) {
+        patternData.append(pattern.toAscii());
+        patternList.append(patternData.last().constData());
+    }
+    patternList.append(NULL);
+    const char **pattern = patterns.isEmpty() ? NULL : patternList.data();
+
+    // list only private keys ( the 1 does )
+    QSet<QString> secretKeyIds;
+    err = gpgme_op_keylist_ext_start(mCtx, pattern, 1, 0);
+    checkErr(err);
+    while (!(err = gpgme_op_keylist_next(mCtx, &key))) {
+        if (key->subkeys) {
+            secretKeyIds.insert(QString::fromAscii(key->subkeys->keyid));
+        }
+        gpgme_key_unref(key);
+    }
+    gpgme_op_keylist_end(mCtx);
+
     GpgKeyList keys;
-    //TODO dont run the loop more often than necessary
+    keys.reserve(patterns.isEmpty() ? mKeyStore.size() : patterns.size());
     // list all keys ( the 0 is for all )
-    err = gpgme_op_keylist_start(mCtx, NULL, 0);
+    err = gpgme_op_keylist_ext_start(mCtx, pattern, 0, 0);
     checkErr(err);
     while (!(err = gpgme_op_keylist_next(mCtx, &key))) {
-        GpgKey gpgkey;
-
-        if (!key->subkeys)
+        if (!key->subkeys) {
+            gpgme_key_unref(key);
             continue;
+        }
 
-        gpgkey.id = key->subkeys->keyid;
-        gpgkey.fpr = key->subkeys->fpr;
+        GpgKey gpgkey;
+        gpgkey.id = QString::fromAscii(key->subkeys->keyid);
+        gpgkey.fpr = QString::fromAscii(key->subkeys->fpr);
         gpgkey.expired = (key->expired != 0);
         gpgkey.revoked = (key->revoked != 0);
+        gpgkey.privkey = secretKeyIds.contains(gpgkey.id);
 
         if (key->uids) {
             gpgkey.name = QString::fromUtf8(key->uids->name);
@@ -279,23 +424,6 @@ GpgKeyList GpgContext::listKeys()
     }
     gpgme_op_keylist_end(mCtx);
 
-    // list only private keys ( the 1 does )
-    gpgme_op_keylist_start(mCtx, NULL, 1);
-    while (!(err = gpgme_op_keylist_next(mCtx, &key))) {
-        if (!key->subkeys)
-            continue;
-        // iterate keys, mark privates
-        GpgKeyList::iterator it = keys.begin();
-        while (it != keys.end()) {
-            if (key->subkeys->keyid == it->id.toStdString())
-                it->privkey = true;
-            it++;
-        }
-
-        gpgme_key_unref(key);
-    }
-    gpgme_op_keylist_end(mCtx);
-
     return keys;
 }
 
@@ -304,16 +432,23 @@ GpgKeyList GpgContext::listKeys()
 
 void GpgContext::deleteKeys(QStringList *uidList)
 {
-    QString tmp;
-    gpgme_key_t key;
-
-    foreach(tmp,  *uidList) {
-        gpgme_op_keylist_start(mCtx, tmp.toAscii().constData(), 0);
-        gpgme_op_keylist_next(mCtx, &key);
+    QStringList fprs;
+    foreach (QString uid, *uidList) {
+        gpgme_key_t key = NULL;
+        gpgme_op_keylist_start(mCtx, uid.toAscii().constData(), 0);
+        err = gpgme_op_keylist_next(mCtx, &key);
         gpgme_op_keylist_end(mCtx);
-        gpgme_op_delete(mCtx, key, 1);
+        if (checkErr(err) || key == NULL) {
+            continue;
+        }
+        if (!checkErr(gpgme_op_delete(mCtx, key, 1)) && key->subkeys) {
+            fprs.append(QString::fromAscii(key->subkeys->fpr));
+        }
+        gpgme_key_unref(key);
+    }
+    if (!fprs.isEmpty()) {
+        notifyKeyDBChanged(fprs);
     }
-    emit signalKeyDBChanged();
 }
 
 /** Encrypt inBuffer for reciepients-uids, write
@@ -322,47 +457,63 @@ void GpgContext::deleteKeys(QStringList *uidList)
 bool GpgContext::encrypt(QStringList *uidList, const QByteArray &inBuffer, QByteArray *outBuffer)
 {
 
-    gpgme_data_t in = 0, out = 0;
     outBuffer->resize(0);
 
     if (uidList->count() == 0) {
-        QMessageBox::critical(0, tr("No Key Selected"), tr("No Key Selected"));
+        showCriticalMessage(tr("No Key Selected"), tr("No Key Selected"));
         return false;
     }
 
-    //gpgme_encrypt_result_t e_result;
-    gpgme_key_t recipients[uidList->count()+1];
+    // gpgme reads inBuffer and writes outBuffer directly, without copies
+    if (mCtx) {
+        GpgData in(inBuffer);
+        GpgData out(outBuffer);
+        // armored output: base64 with a newline every 64 characters, plus header
+        out.setSizeHint(in.size() * 4 / 3 * 65 / 64 + 1024);
+        err = in.error() ? in.error() : out.error();
+        checkErr(err);
+        if (!err) {
+            encryptData(uidList, in.data(), out.data());
+        }
+    }
+    if (err != GPG_ERR_NO_ERROR) {
+        outBuffer->resize(0);
+    }
+    return (err == GPG_ERR_NO_ERROR);
+}
 
-    /* get key for user */
-    for (int i = 0; i < uidList->count(); i++) {
-        // the last 0 is for public keys, 1 would return private keys
-        gpgme_op_keylist_start(mCtx, uidList->at(i).toAscii().constData(), 0);
-        gpgme_op_keylist_next(mCtx, &recipients[i]);
-        gpgme_op_keylist_end(mCtx);
+/** Encrypt inFile for reciepients-uids, write result to outFile.
+ *  Both files have to be opened by the caller, the data is streamed
+ *  between the file descriptors and never held in memory as a whole.
+ */
+bool GpgContext::encryptFile(QStringList *uidList, QFile *inFile, QFile *outFile)
+{
+    if (uidList->count() == 0) {
+        showCriticalMessage(tr("No Key Selected"), tr("No Key Selected"));
+        return false;
     }
-    //Last entry in array has to be NULL
-    recipients[uidList->count()] = NULL;
 
-    //If the last parameter isnt 0, a private copy of data is made
-    if (mCtx) {
-		err = gpgme_data_new_from_mem(&in, inBuffer.data(), inBuffer.size(), 1);
-		checkErr(err);
+    QVector<gpgme_key_t> recipients = resolveKeys(uidList);
+    bool success = encryptFile(recipients.data(), inFile, outFile);
+    releaseKeys(&recipients);
+    return success;
+}
+
+/** Like encryptFile above, but with already resolved keys, e.g. for
+ *  encrypting many files for the same recipients.
+ */
+bool GpgContext::encryptFile(gpgme_key_t recipients[], QFile *inFile, QFile *outFile)
+{
+    gpgme_data_t in = 0, out = 0;
+
+    err = gpgme_data_new_from_fd(&in, inFile->handle());
+    checkErr(err);
+    if (!err) {
+        err = gpgme_data_new_from_fd(&out, outFile->handle());
+        checkErr(err);
         if (!err) {
-			err = gpgme_data_new(&out);
-			checkErr(err);
-	        if (!err) {
-				err = gpgme_op_encrypt(mCtx, recipients, GPGME_ENCRYPT_ALWAYS_TRUST, in, out);
-				checkErr(err);
-				if (!err) {
-					err = readToBuffer(out, outBuffer);
-					checkErr(err);
-				}
-			}
-		}
-	}
-    /* unref all keys */
-    for (int i = 0; i <= uidList->count(); i++) {
-        gpgme_key_unref(recipients[i]);
+            encryptData(recipients, in, out);
+        }
     }
     if (in) {
         gpgme_data_release(in);
@@ -373,55 +524,121 @@ bool GpgContext::encrypt(QStringList *uidList, const QByteArray &inBuffer, QByte
     return (err == GPG_ERR_NO_ERROR);
 }
 
+/** Encrypt the data read from in for reciepients-uids, write result to out.
+ *  The data is passed through GpgData callbacks, so in can produce it
+ *  while gpgme reads, e.g. a MimeEncoder encoding attachments.
+ */
+bool GpgContext::encryptDevice(QStringList *uidList, QIODevice *in, QIODevice *out)
+{
+    if (uidList->count() == 0) {
+        showCriticalMessage(tr("No Key Selected"), tr("No Key Selected"));
+        return false;
+    }
+
+    GpgData inData(in);
+    GpgData outData(out);
+    err = inData.error() ? inData.error() : outData.error();
+    checkErr(err);
+    if (!err) {
+        encryptData(uidList, inData.data(), outData.data());
+    }
+    return (err == GPG_ERR_NO_ERROR);
+}
+
+/** Encrypt the gpgme-data in for the keys in uidList into out,
+ *  used by encrypt()
+ */
+bool GpgContext::encryptData(QStringList *uidList, gpgme_data_t in, gpgme_data_t out)
+{
+    QVector<gpgme_key_t> recipients = resolveKeys(uidList);
+    bool success = encryptData(recipients.data(), in, out);
+    releaseKeys(&recipients);
+    return success;
+}
+
+bool GpgContext::encryptData(gpgme_key_t recipients[], gpgme_data_t in, gpgme_data_t out)
+{
+    err = gpgme_op_encrypt(mCtx, recipients, GPGME_ENCRYPT_ALWAYS_TRUST, in, out);
+    checkErr(err);
+    return (err == GPG_ERR_NO_ERROR);
+}
+
+/** Get the public keys for the uids in uidList from the keyring.
+ *  The returned vector is terminated by NULL, so data() can be passed
+ *  to gpgme, the keys have to be released with releaseKeys().
+ */
+QVector<gpgme_key_t> GpgContext::resolveKeys(QStringList *uidList)
+{
+    QVector<gpgme_key_t> keys(uidList->count() + 1, NULL);
+
+    /* get key for user */
+    for (int i = 0; i < uidList->count(); i++) {
+        keys[i] = mKeyCache->key(mCtx, uidList->at(i));
+    }
+    return keys;
+}
+
+void GpgContext::releaseKeys(QVector<gpgme_key_t> *keys)
+{
+    /* unref all keys */
+    for (int i = 0; i < keys->size(); i++) {
+        gpgme_key_unref(keys->at(i));
+    }
+    keys->clear();
+}
+
 /** Decrypt QByteAarray, return QByteArray
  *  mainly from http://basket.kde.org/ (kgpgme.cpp)
  */
 bool GpgContext::decrypt(const QByteArray &inBuffer, QByteArray *outBuffer)
 {
-    gpgme_data_t in = 0, out = 0;
-    gpgme_decrypt_result_t result = 0;
-    QString errorString;
+    return decryptVerify(inBuffer, outBuffer, NULL);
+}
 
+/** Like decrypt(), but with gpgme_op_decrypt_verify, so a signed and encrypted
+ *  text doesn't have to be verified in a second run of gpg
+ */
+bool GpgContext::decryptVerify(const QByteArray &inBuffer, QByteArray *outBuffer, GpgSignatureList *signatures)
+{
     outBuffer->resize(0);
+    if (signatures != NULL) {
+        signatures->clear();
+    }
     if (mCtx) {
-        err = gpgme_data_new_from_mem(&in, inBuffer.data(), inBuffer.size(), 1);
+        GpgData in(inBuffer);
+        GpgData out(outBuffer);
+        // the plaintext is usually smaller than the armored input, if it
+        // was compressed, the buffer grows geometrically
+        out.setSizeHint(in.size());
+        err = in.error() ? in.error() : out.error();
         checkErr(err);
         if (!err) {
-            err = gpgme_data_new(&out);
-            checkErr(err);
-            if (!err) {
-                err = gpgme_op_decrypt(mCtx, in, out);
-                checkErr(err);
-
-                if(gpg_err_code(err) == GPG_ERR_DECRYPT_FAILED) {
-                    errorString.append(gpgErrString(err)).append("<br>");
-                    result = gpgme_op_decrypt_result(mCtx);
-                    checkErr(result->recipients->status);
-                    errorString.append(gpgErrString(result->recipients->status)).append("<br>");
-                    errorString.append(tr("<br>No private key with id %1 present in keyring").arg(result->recipients->keyid));
-                } else {
-                    errorString.append(gpgErrString(err)).append("<br>");
-                }
-
-                if (!err) {
-                    result = gpgme_op_decrypt_result(mCtx);
-                    if (result->unsupported_algorithm) {
-                        QMessageBox::critical(0, tr("Unsupported algorithm"), result->unsupported_algorithm);
-                    } else {
-                        err = readToBuffer(out, outBuffer);
-                        checkErr(err);
-                    }
-                }
-            }
+            decryptData(in.data(), out.data(), signatures);
         }
     }
-    if (gpg_err_code(err) != GPG_ERR_NO_ERROR && gpg_err_code(err) != GPG_ERR_CANCELED) {
-        QMessageBox::critical(0, tr("Error decrypting:"), errorString);
-        return false;
+
+    // don't return partially decrypted data
+    if (err != GPG_ERR_NO_ERROR) {
+        outBuffer->resize(0);
     }
+    return (err == GPG_ERR_NO_ERROR);
+}
 
-    if (! settings.value("general/rememberPassword").toBool()) {
-        clearPasswordCache();
+/** Decrypt inFile to outFile, the files have to be opened by the caller.
+ *  Like encryptFile() the data is streamed between the file descriptors.
+ */
+bool GpgContext::decryptFile(QFile *inFile, QFile *outFile)
+{
+    gpgme_data_t in = 0, out = 0;
+
+    err = gpgme_data_new_from_fd(&in, inFile->handle());
+    checkErr(err);
+    if (!err) {
+        err = gpgme_data_new_from_fd(&out, outFile->handle());
+        checkErr(err);
+        if (!err) {
+            decryptData(in, out);
+        }
     }
 
     if (in) {
@@ -433,36 +650,73 @@ bool GpgContext::decrypt(const QByteArray &inBuffer, QByteArray *outBuffer)
     return (err == GPG_ERR_NO_ERROR);
 }
 
-/**  Read gpgme-Data to QByteArray
- *   mainly from http://basket.kde.org/ (kgpgme.cpp)
+/** Decrypt the gpgme-data in into out, show an errormessage if decryption fails,
+ *  used by decrypt() and decryptFile()
  */
-#define BUF_SIZE (32 * 1024)
-gpgme_error_t GpgContext::readToBuffer(gpgme_data_t in, QByteArray *outBuffer)
+bool GpgContext::decryptData(gpgme_data_t in, gpgme_data_t out, GpgSignatureList *signatures)
 {
-    int ret;
-    gpgme_error_t err = GPG_ERR_NO_ERROR;
+    gpgme_decrypt_result_t result = 0;
+    QString errorString;
 
-    ret = gpgme_data_seek(in, 0, SEEK_SET);
-    if (ret) {
-        err = gpgme_err_code_from_errno(errno);
-        checkErr(err, "failed dataseek in readToBuffer");
+    if (signatures != NULL) {
+        err = gpgme_op_decrypt_verify(mCtx, in, out);
     } else {
-        char *buf = new char[BUF_SIZE + 2];
+        err = gpgme_op_decrypt(mCtx, in, out);
+    }
+    checkErr(err);
 
-        if (buf) {
-            while ((ret = gpgme_data_read(in, buf, BUF_SIZE)) > 0) {
-                uint size = outBuffer->size();
-                outBuffer->resize(size + ret);
-                memcpy(outBuffer->data() + size, buf, ret);
-            }
-            if (ret < 0) {
-                err = gpgme_err_code_from_errno(errno);
-                checkErr(err, "failed data_read in readToBuffer");
-            }
-            delete[] buf;
+    if(gpg_err_code(err) == GPG_ERR_DECRYPT_FAILED) {
+        errorString.append(gpgErrString(err)).append("<br>");
+        result = gpgme_op_decrypt_result(mCtx);
+        checkErr(result->recipients->status);
+        errorString.append(gpgErrString(result->recipients->status)).append("<br>");
+        errorString.append(tr("<br>No private key with id %1 present in keyring").arg(result->recipients->keyid));
+    } else {
+        errorString.append(gpgErrString(err)).append("<br>");
+    }
+
+    if (!err) {
+        result = gpgme_op_decrypt_result(mCtx);
+        if (result->unsupported_algorithm) {
+            showCriticalMessage(tr("Unsupported algorithm"), result->unsupported_algorithm);
+            err = gpg_error(GPG_ERR_UNSUPPORTED_ALGORITHM);
         }
     }
-    return err;
+
+    if (gpg_err_code(err) != GPG_ERR_NO_ERROR && gpg_err_code(err) != GPG_ERR_CANCELED
+            && gpg_err_code(err) != GPG_ERR_UNSUPPORTED_ALGORITHM) {
+        showCriticalMessage(tr("Error decrypting:"), errorString);
+        return false;
+    }
+
+    if (! settings.value("general/rememberPassword").toBool()) {
+        clearPasswordCache();
+    }
+
+    if (signatures != NULL && err == GPG_ERR_NO_ERROR) {
+        *signatures = signatureList(gpgme_op_verify_result(mCtx));
+    }
+
+    return (err == GPG_ERR_NO_ERROR);
+}
+
+/** Copy the signatures of a verify result, the result itself is only valid
+ *  until the next operation on the context
+ */
+GpgSignatureList GpgContext::signatureList(gpgme_verify_result_t result)
+{
+    GpgSignatureList signatures;
+    if (result == NULL) {
+        return signatures;
+    }
+    for (gpgme_signature_t sign = result->signatures; sign != NULL; sign = sign->next) {
+        GpgSignature signature;
+        signature.fpr = QString::fromAscii(sign->fpr);
+        signature.status = sign->status;
+        signature.timestamp.setTime_t(sign->timestamp);
+        signatures.append(signature);
+    }
+    return signatures;
 }
 
 /** The Passphrase window, if not provided by env-Var GPG_AGENT_INFO
@@ -480,6 +734,16 @@ gpgme_error_t GpgContext::passphrase(const char *uid_hint,
                                   const char * /*passphrase_info*/,
                                   int last_was_bad, int fd)
 {
+    /** worker contexts ask the gui context, which also holds the password cache */
+    if (mGuiCtx) {
+        int ret = GPG_ERR_CANCELED;
+        QMetaObject::invokeMethod(mGuiCtx, "slotPassphrase", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(int, ret),
+                                  Q_ARG(QString, QString::fromUtf8(uid_hint)),
+                                  Q_ARG(int, last_was_bad), Q_ARG(int, fd));
+        return ret;
+    }
+
     gpgme_error_t returnValue = GPG_ERR_CANCELED;
     QString passwordDialogMessage;
     QString gpgHint = QString::fromUtf8(uid_hint);
@@ -501,7 +765,10 @@ gpgme_error_t GpgContext::passphrase(const char *uid_hint,
         passwordDialogMessage += "<b>"+tr("Enter Password for")+"</b><br>" + gpgHint + "<br>";
     }
 
-    if (mPasswordCache.isEmpty()) {
+    if (mPasswordCache.isEmpty() && QApplication::type() == QApplication::Tty) {
+        // without gui only a password set with setPassword() can be used
+        result = false;
+    } else if (mPasswordCache.isEmpty()) {
         QString password = QInputDialog::getText(QApplication::activeWindow(), tr("Enter Password"),
                            passwordDialogMessage, QLineEdit::Password,
                            "", &result);
@@ -540,9 +807,48 @@ gpgme_error_t GpgContext::passphrase(const char *uid_hint,
     return returnValue;
 }
 
+int GpgContext::slotPassphrase(QString uidHint, int lastWasBad, int fd)
+{
+    return passphrase(uidHint.toUtf8().constData(), NULL, lastWasBad, fd);
+}
+
+void GpgContext::progressCb(void *hook, const char * /*what*/, int /*type*/,
+                            int current, int total)
+{
+    GpgContext *gpg = static_cast<GpgContext*>(hook);
+    emit gpg->signalProgress(current, total);
+}
+
+/** Progress of reading the input, gpg reads keyrings key by key, so
+ *  this advances with the imported keys. Only emitted, when the
+ *  permille changes, to not flood the gui with queued signals.
+ */
+void GpgContext::dataProgressCb(void *hook, qint64 current, qint64 total)
+{
+    GpgContext *gpg = static_cast<GpgContext*>(hook);
+    if (total <= 0) {
+        return;
+    }
+    int permille = int(current * 1000 / total);
+    if (permille != gpg->mProgressPermille) {
+        gpg->mProgressPermille = permille;
+        emit gpg->signalProgress(permille, 1000);
+    }
+}
+
+void GpgContext::setPassword(const QByteArray &password)
+{
+    clearPasswordCache();
+    mPasswordCache = password;
+}
+
 /** also from kgpgme.cpp, seems to clear password from mem */
 void GpgContext::clearPasswordCache()
 {
+    if (mGuiCtx) {
+        QMetaObject::invokeMethod(mGuiCtx, "clearPasswordCache", Qt::QueuedConnection);
+        return;
+    }
     if (mPasswordCache.size() > 0) {
         mPasswordCache.fill('\0');
         mPasswordCache.truncate(0);
@@ -550,6 +856,56 @@ void GpgContext::clearPasswordCache()
 }
 
 // error-handling
+/** Show an errormessage, worker contexts let the gui context show it
+ */
+void GpgContext::showCriticalMessage(const QString &title, const QString &text)
+{
+    mLastErrorString = title + " " + text;
+    if (!mShowErrorMessages) {
+        return;
+    }
+    if (mGuiCtx) {
+        QMetaObject::invokeMethod(mGuiCtx, "slotShowCriticalMessage", Qt::QueuedConnection,
+                                  Q_ARG(QString, title), Q_ARG(QString, text));
+    } else {
+        slotShowCriticalMessage(title, text);
+    }
+}
+
+void GpgContext::slotShowCriticalMessage(QString title, QString text)
+{
+    if (QApplication::type() == QApplication::Tty) {
+        qWarning() << title << text;
+        return;
+    }
+    QMessageBox::critical(0, title, text);
+}
+
+void GpgContext::setShowErrorMessages(bool show)
+{
+    mShowErrorMessages = show;
+}
+
+/** The message of the last error shown with showCriticalMessage, or
+ *  the gpgme error of the last operation
+ */
+QString GpgContext::lastErrorString() const
+{
+    if (!mLastErrorString.isEmpty()) {
+        return mLastErrorString;
+    }
+    if (err != GPG_ERR_NO_ERROR) {
+        return gpgErrString(err);
+    }
+    return QString();
+}
+
+void GpgContext::clearLastError()
+{
+    mLastErrorString.clear();
+    err = GPG_ERR_NO_ERROR;
+}
+
 int GpgContext::checkErr(gpgme_error_t err, QString comment) const
 {
     //if (err != GPG_ERR_NO_ERROR && err != GPG_ERR_CANCELED) {
@@ -609,142 +965,167 @@ void GpgContext::executeGpgCommand(QStringList arguments, QByteArray *stdOut, QB
     qDebug() << *stdOut;
 }
 
-/***
+/** Verify signature
   * if sigbuffer not set, the inbuffer should contain signed text
-  *
-  * TODO: return type should contain:
-  * -> list of sigs
-  * -> valid
-  * -> errors
   */
-gpgme_signature_t GpgContext::verify(QByteArray *inBuffer, QByteArray *sigBuffer) {
-
-    int error=0;
-    gpgme_data_t in;
-    gpgme_error_t err;
-    gpgme_signature_t sign;
-    gpgme_verify_result_t result;
+GpgSignatureList GpgContext::verify(QByteArray *inBuffer, QByteArray *sigBuffer) {
 
-    err = gpgme_data_new_from_mem(&in, inBuffer->data(), inBuffer->size(), 1);
-    checkErr(err);
+    GpgSignatureList signatures;
+    GpgData in(*inBuffer);
 
     if (sigBuffer != NULL ) {
-       gpgme_data_t sigdata;
-       err = gpgme_data_new_from_mem(&sigdata, sigBuffer->data(), sigBuffer->size(), 1);
-       err = gpgme_op_verify (mCtx, sigdata, in, NULL);
+       GpgData sigdata(*sigBuffer);
+       err = gpgme_op_verify (mCtx, sigdata.data(), in.data(), NULL);
     } else {
-       err = gpgme_op_verify (mCtx, in, NULL, in);
+       // the plaintext of the signed text is not needed
+       QByteArray plain;
+       GpgData out(&plain);
+       err = gpgme_op_verify (mCtx, in.data(), NULL, out.data());
     }
-    error = checkErr(err);
 
-    if (error != 0) {
-        return NULL;
+    if (checkErr(err) == GPG_ERR_NO_ERROR) {
+        signatures = signatureList(gpgme_op_verify_result(mCtx));
     }
-
-    result = gpgme_op_verify_result (mCtx);
-    sign = result->signatures;
-    return sign;
+    return signatures;
 }
 
-/***
-  * return type should contain:
-  * -> list of sigs
-  * -> valid
-  * -> decrypted message
-  */
-//void GpgContext::decryptVerify(QByteArray in) {
+/** Verify the detached signature sigBuffer of inFile, only the signature
+ *  is held in memory, the signed data is read from the file descriptor.
+ */
+GpgSignatureList GpgContext::verifyFile(QFile *inFile, const QByteArray &sigBuffer)
+{
+    GpgSignatureList signatures;
+    gpgme_data_t in = 0;
 
-/*    gpgme_error_t err;
-    gpgme_data_t in, out;
+    GpgData sigdata(sigBuffer);
+    err = sigdata.error();
+    if (!err) {
+        err = gpgme_data_new_from_fd(&in, inFile->handle());
+    }
+    if (!err) {
+        err = gpgme_op_verify(mCtx, sigdata.data(), in, NULL);
+    }
+    if (checkErr(err) == GPG_ERR_NO_ERROR) {
+        signatures = signatureList(gpgme_op_verify_result(mCtx));
+    }
 
-    gpgme_decrypt_result_t decrypt_result;
-    gpgme_verify_result_t verify_result;
+    if (in) {
+        gpgme_data_release(in);
+    }
+    return signatures;
+}
 
-    err = gpgme_op_decrypt_verify (mCtx, in, out);
-    decrypt_result = gpgme_op_decrypt_result (mCtx);
+bool GpgContext::sign(QStringList *uidList, const QByteArray &inBuffer, QByteArray *outBuffer, bool detached) {
 
-    verify_result = gpgme_op_verify_result (mCtx);
- */
-//}
+    if (uidList->count() == 0) {
+        showCriticalMessage(tr("Key Selection"), tr("No Private Key Selected"));
+        return false;
+    }
 
-bool GpgContext::sign(QStringList *uidList, const QByteArray &inBuffer, QByteArray *outBuffer, bool detached) {
+    GpgData in(inBuffer);
+    GpgData out(outBuffer);
+    // a clearsigned text is the text plus the armored signature
+    out.setSizeHint(detached ? 4096 : in.size() + 4096);
+    err = in.error() ? in.error() : out.error();
+    checkErr(err);
+    if (!err) {
+        signData(uidList, in.data(), out.data(), detached);
+    }
+    if (err != GPG_ERR_NO_ERROR) {
+        outBuffer->resize(0);
+    }
 
-    gpgme_error_t err;
-    gpgme_data_t in, out;
-    gpgme_sign_result_t result;
-    gpgme_sig_mode_t mode;
+    return (err == GPG_ERR_NO_ERROR);
+}
+
+/** Create a detached signature of inFile in outFile, the files have
+ *  to be opened by the caller.
+ */
+bool GpgContext::signFile(QStringList *uidList, QFile *inFile, QFile *outFile)
+{
+    gpgme_data_t in = 0, out = 0;
 
     if (uidList->count() == 0) {
-        QMessageBox::critical(0, tr("Key Selection"), tr("No Private Key Selected"));
+        showCriticalMessage(tr("Key Selection"), tr("No Private Key Selected"));
         return false;
     }
 
-    // at start or end?
-    gpgme_signers_clear(mCtx);
+    err = gpgme_data_new_from_fd(&in, inFile->handle());
+    checkErr(err);
+    if (!err) {
+        err = gpgme_data_new_from_fd(&out, outFile->handle());
+        checkErr(err);
+        if (!err) {
+            signData(uidList, in, out, true);
+        }
+    }
+
+    if (in) {
+        gpgme_data_release(in);
+    }
+    if (out) {
+        gpgme_data_release(out);
+    }
+    return (err == GPG_ERR_NO_ERROR);
+}
 
-    //gpgme_encrypt_result_t e_result;
-    gpgme_key_t signers[uidList->count()+1];
+/** Sign the gpgme-data in with the keys in uidList into out,
+ *  used by sign() and signFile()
+ */
+bool GpgContext::signData(QStringList *uidList, gpgme_data_t in, gpgme_data_t out, bool detached)
+{
+    gpgme_sig_mode_t mode;
 
+    // at start or end?
+    gpgme_signers_clear(mCtx);
 
-    // TODO: do we really need array? adding one key in loop should be ok
+    QVector<gpgme_key_t> signers = resolveKeys(uidList);
     for (int i = 0; i < uidList->count(); i++) {
-        // the last 0 is for public keys, 1 would return private keys
-        gpgme_op_keylist_start(mCtx, uidList->at(i).toAscii().constData(), 0);
-        gpgme_op_keylist_next(mCtx, &signers[i]);
-        gpgme_op_keylist_end(mCtx);
-
-        err = gpgme_signers_add (mCtx, signers[i]);
+        if (signers.at(i) == NULL) {
+            continue;
+        }
+        err = gpgme_signers_add (mCtx, signers.at(i));
         checkErr(err);
     }
 
-     err = gpgme_data_new_from_mem(&in, inBuffer.data(), inBuffer.size(), 1);
-     checkErr(err);
-     err = gpgme_data_new (&out);
-     checkErr(err);
-
-     /*
-         `GPGME_SIG_MODE_NORMAL'
-               A normal signature is made, the output includes the plaintext
-               and the signature.
+    /*
+        `GPGME_SIG_MODE_NORMAL'
+              A normal signature is made, the output includes the plaintext
+              and the signature.
 
-         `GPGME_SIG_MODE_DETACH'
-               A detached signature is made.
+        `GPGME_SIG_MODE_DETACH'
+              A detached signature is made.
 
-         `GPGME_SIG_MODE_CLEAR'
-               A clear text signature is made.  The ASCII armor and text
-               mode settings of the context are ignored.
-     */
+        `GPGME_SIG_MODE_CLEAR'
+              A clear text signature is made.  The ASCII armor and text
+              mode settings of the context are ignored.
+    */
 
-     if(detached) {
+    if(detached) {
         mode =  GPGME_SIG_MODE_DETACH;
-     } else {
+    } else {
         mode = GPGME_SIG_MODE_CLEAR;
-     }
-
-     err = gpgme_op_sign (mCtx, in, out, mode);
-     checkErr (err);
+    }
 
-     if (err == GPG_ERR_CANCELED) {
-         return false;
-     }
+    err = gpgme_op_sign (mCtx, in, out, mode);
+    checkErr (err);
 
-     if (err != GPG_ERR_NO_ERROR) {
-         QMessageBox::critical(0, tr("Error signing:"), QString::fromUtf8(gpgme_strerror(err)));
-         return false;
-     }
+    releaseKeys(&signers);
 
-     result = gpgme_op_sign_result (mCtx);
-     err = readToBuffer(out, outBuffer);
-     checkErr (err);
+    if (err == GPG_ERR_CANCELED) {
+        return false;
+    }
 
-     gpgme_data_release(in);
-     gpgme_data_release(out);
+    if (err != GPG_ERR_NO_ERROR) {
+        showCriticalMessage(tr("Error signing:"), QString::fromUtf8(gpgme_strerror(err)));
+        return false;
+    }
 
-     if (! settings.value("general/rememberPassword").toBool()) {
-         clearPasswordCache();
-     }
+    if (! settings.value("general/rememberPassword").toBool()) {
+        clearPasswordCache();
+    }
 
-     return (err == GPG_ERR_NO_ERROR);
+    return true;
 }
 
 /*
@@ -789,38 +1170,36 @@ QString GpgContext::beautifyFingerprint(QString fingerprint)
     return fingerprint;
 }
 
-void GpgContext::slotRefreshKeyList() {
-    mKeyList = this->listKeys();
+GpgKey GpgContext::getKeyByFpr(const QString &fpr) const {
+    const GpgKey *key = mKeyStore.findByFpr(fpr);
+    return key ? *key : GpgKey();
 }
 
-/**
- * note: privkey status is not returned
- */
-GpgKey GpgContext::getKeyByFpr(QString fpr) {
+GpgKey GpgContext::getKeyById(const QString &id) const {
+    const GpgKey *key = mKeyStore.findById(id);
+    return key ? *key : GpgKey();
+}
 
-    //GpgKeyList list = this->listKeys();
-    foreach  (GpgKey key, mKeyList) {
-        if(key.fpr == fpr) {
-            return key;
+bool GpgContext::signerKeysAdded(const GpgSignatureList &signatures) const {
+    foreach (const GpgSignature &signature, signatures) {
+        // the fpr of a signature with missing key is its key id
+        if (gpg_err_code(signature.status) == GPG_ERR_NO_PUBKEY
+                && mKeyStore.findByName(signature.fpr) != NULL) {
+            return true;
         }
     }
-
-    return GpgKey();
+    return false;
 }
 
-/**
- * note: privkey status is not returned
- */
-GpgKey GpgContext::getKeyById(QString id) {
+const GpgKeyStore *GpgContext::keyStore() const {
+    return &mKeyStore;
+}
 
-    //GpgKeyList list = this->listKeys();
-    foreach  (GpgKey key, mKeyList) {
-        if(key.id == id) {
-            return key;
-        }
+const KeySearchIndex *GpgContext::keySearchIndex() {
+    if (mKeySearchIndex == 0) {
+        mKeySearchIndex = new KeySearchIndex(&mKeyStore, this);
     }
-
-    return GpgKey();
+    return mKeySearchIndex;
 }
 
 QString GpgContext::getGpgmeVersion() {
@@ -23,6 +23,10 @@
 #define __SGPGMEPP_CONTEXT_H__
 
 #include "gpgconstants.h"
+#include "gpgkeystore.h"
+#include "gpgkeycache.h"
+#include "gpgdata.h"
+#include "keysearchindex.h"
 #include <locale.h>
 #include <errno.h>
 #include <gpgme.h>
@@ -37,31 +41,27 @@ class QByteArray;
 class QString;
 QT_END_NAMESPACE
 
-class GpgKey
+class GpgImportedKey
 {
 public:
-    GpgKey() {
-        privkey = false;
-    }
-    QString id;
-    QString name;
-    QString email;
     QString fpr;
-    bool privkey;
-    bool expired;
-    bool revoked;
+    int importStatus;
 };
 
-typedef QLinkedList< GpgKey > GpgKeyList;
+typedef QLinkedList< GpgImportedKey > GpgImportedKeyList;
 
-class GpgImportedKey
+class GpgSignature
 {
 public:
-    QString fpr;
-    int importStatus;
+    GpgSignature() {
+        status = GPG_ERR_NO_ERROR;
+    }
+    QString fpr; /** fingerprint, or key id if the key is not in the keyring */
+    gpgme_error_t status;
+    QDateTime timestamp;
 };
 
-typedef QLinkedList< GpgImportedKey > GpgImportedKeyList;
+typedef QList< GpgSignature > GpgSignatureList;
 
 class GpgImportInformation
 {
@@ -82,6 +82,27 @@ public:
         not_imported = 0;
     }
 
+    /**
+     * @details Add the counts of another import, e.g. of the next file.
+     */
+    GpgImportInformation &operator+=(const GpgImportInformation &other) {
+        considered += other.considered;
+        no_user_id += other.no_user_id;
+        imported += other.imported;
+        imported_rsa += other.imported_rsa;
+        unchanged += other.unchanged;
+        new_user_ids += other.new_user_ids;
+        new_sub_keys += other.new_sub_keys;
+        new_signatures += other.new_signatures;
+        new_revocations += other.new_revocations;
+        secret_read += other.secret_read;
+        secret_imported += other.secret_imported;
+        secret_unchanged += other.secret_unchanged;
+        not_imported += other.not_imported;
+        importedKeys += other.importedKeys;
+        return *this;
+    }
+
     int considered;
     int no_user_id;
     int imported;
@@ -96,6 +117,19 @@ public:
     int secret_unchanged;
     int not_imported;
     GpgImportedKeyList importedKeys;
+
+    /**
+     * @return The fingerprints of the new or changed keys, unchanged keys are left out.
+     */
+    QStringList changedFingerprints() const {
+        QStringList fprs;
+        foreach (const GpgImportedKey &key, importedKeys) {
+            if (key.importStatus != 0 && !fprs.contains(key.fpr)) {
+                fprs.append(key.fpr);
+            }
+        }
+        return fprs;
+    }
 };
 
 namespace GpgME
@@ -107,8 +141,33 @@ class GpgContext : public QObject
 
 public:
     GpgContext(); // Constructor
+    /**
+     * @details Constructor for a worker context with an own gpgme-context,
+     * which can be used in another thread than guiCtx (e.g. by GpgJob).
+     * Passphrase requests and error messages are handled by guiCtx.
+     *
+     * @param guiCtx The context living in the gui thread.
+     */
+    GpgContext(GpgContext *guiCtx);
     ~GpgContext(); // Destructor
     GpgImportInformation importKey(QByteArray inBuffer);
+    /**
+     * @details Import keys from a file opened by the caller. The file is fed to
+     * gpgme while it is read, so keyrings of any size can be imported, progress
+     * is reported by signalProgress. signalKeyDBChanged is not emitted, so
+     * several files can be imported with one refresh: call notifyKeyDBChanged()
+     * with changedFingerprints() of all results after the last one.
+     */
+    GpgImportInformation importKeyFile(QFile *inFile);
+    /**
+     * @details Report changed keys to the gui context, may be called from any
+     * thread and from worker contexts. Changes are collected and applied to the
+     * keystore together, after no further change came in for a short time.
+     *
+     * @param fprs The fingerprints of added, changed or deleted keys, empty if
+     * the whole keyring may have changed.
+     */
+    Q_INVOKABLE void notifyKeyDBChanged(const QStringList &fprs = QStringList());
     bool exportKeys(QStringList *uidList, QByteArray *outBuffer);
     void generateKey(QString *params);
     GpgKeyList listKeys();
@@ -116,11 +175,69 @@ public:
     bool encrypt(QStringList *uidList, const QByteArray &inBuffer,
                  QByteArray *outBuffer);
     bool decrypt(const QByteArray &inBuffer, QByteArray *outBuffer);
-    void clearPasswordCache();
+    /**
+     * @details Encrypt, decrypt or sign from file to file. The files have to be
+     * opened by the caller, output is written by gpgme directly to the file
+     * descriptor, so memory usage doesn't depend on the size of the file.
+     */
+    bool encryptFile(QStringList *uidList, QFile *inFile, QFile *outFile);
+    bool encryptFile(gpgme_key_t recipients[], QFile *inFile, QFile *outFile);
+    bool decryptFile(QFile *inFile, QFile *outFile);
+    bool signFile(QStringList *uidList, QFile *inFile, QFile *outFile);
+    /**
+     * @details Encrypt from device to device, e.g. a MimeEncoder to a file.
+     * The devices have to be opened by the caller and may be sequential.
+     */
+    bool encryptDevice(QStringList *uidList, QIODevice *in, QIODevice *out);
+    Q_INVOKABLE void clearPasswordCache();
+    /**
+     * @details Use password for the next passphrase requests, instead of asking
+     * the user. Without gui (see BatchMode), this is the only way to pass a password.
+     */
+    void setPassword(const QByteArray &password);
+    /**
+     * @details Cancel the running operation, may be called from any thread.
+     */
+    void cancel();
+    /**
+     * @details Get the public keys for uidList, e.g. to resolve the recipients
+     * only once for many files. The keys come from the key cache, which is
+     * cleared on signalKeyDBChanged. The vector is NULL terminated, release the
+     * keys with releaseKeys().
+     */
+    QVector<gpgme_key_t> resolveKeys(QStringList *uidList);
+    static void releaseKeys(QVector<gpgme_key_t> *keys);
+    /**
+     * @details If show is false, error messages are not shown in a message box,
+     * but only remembered for lastErrorString().
+     */
+    void setShowErrorMessages(bool show);
+    QString lastErrorString() const;
+    void clearLastError();
     void exportSecretKey(QString uid, QByteArray *outBuffer);
     gpgme_key_t getKeyDetails(QString uid);
-    gpgme_signature_t verify(QByteArray *inBuffer, QByteArray *sigBuffer = NULL);
-//    void decryptVerify(QByteArray in);
+    /**
+     * @details Verify inBuffer, or the detached signature sigBuffer of inBuffer.
+     *
+     * @return The signatures found, empty if there are none or verifying failed.
+     */
+    GpgSignatureList verify(QByteArray *inBuffer, QByteArray *sigBuffer = NULL);
+    /**
+     * @details Verify the detached signature sigBuffer of inFile, which has to
+     * be opened by the caller. The file is streamed, so it may be larger than memory.
+     */
+    GpgSignatureList verifyFile(QFile *inFile, const QByteArray &sigBuffer);
+
+    /**
+     * @details Decrypt inBuffer and verify the signatures of the encrypted text
+     * in the same pass, signatures is empty if the text isn't signed.
+     */
+    bool decryptVerify(const QByteArray &inBuffer, QByteArray *outBuffer, GpgSignatureList *signatures);
+    /**
+     * @return true, if the key of a signature, which couldn't be checked because
+     * the key was missing, is in the keyring now, so it's worth verifying again.
+     */
+    bool signerKeysAdded(const GpgSignatureList &signatures) const;
     bool sign(QStringList *uidList, const QByteArray &inBuffer, QByteArray *outBuffer, bool detached = false);
     /**
      * @details If text contains PGP-message, put a linebreak before the message,
@@ -130,8 +247,22 @@ public:
      */
     void preventNoDataErr(QByteArray *in);
 
-    GpgKey getKeyByFpr(QString fpr);
-    GpgKey getKeyById(QString id);
+    /**
+     * @details Lookups in the cached keylist, which is updated on signalKeyDBChanged.
+     * If no key is found, an empty GpgKey is returned.
+     */
+    GpgKey getKeyByFpr(const QString &fpr) const;
+    GpgKey getKeyById(const QString &id) const;
+
+    /**
+     * @details The cached keylist, models may follow its signals.
+     */
+    const GpgKeyStore *keyStore() const;
+
+    /**
+     * @details Search index over the cached keylist, created on first use.
+     */
+    const KeySearchIndex *keySearchIndex();
 
     static QString gpgErrString(gpgme_error_t err);
     static QString getGpgmeVersion();
@@ -147,21 +278,59 @@ public:
     int textIsSigned(const QByteArray &text);
     QString beautifyFingerprint(QString fingerprint);
 
+public slots:
+    /**
+     * @details Apply the pending keyring changes to the keystore now, e.g. before
+     * looking up just imported keys. Does nothing, if there are no changes.
+     */
+    void slotFlushKeyDBChanged();
+
 signals:
-    void signalKeyDBChanged();
+    /**
+     * @details Emitted once for a batch of changes, after the keystore is updated.
+     *
+     * @param fprs The changed keys, empty if the whole keyring was reread.
+     */
+    void signalKeyDBChanged(const QStringList &fprs);
+    /**
+     * @details Progress of the running operation, emitted by worker contexts
+     * and by importKeyFile().
+     */
+    void signalProgress(int current, int total);
 
 private slots:
-    void slotRefreshKeyList();
+    int slotPassphrase(QString uidHint, int lastWasBad, int fd);
+    void slotShowCriticalMessage(QString title, QString text);
 
 private:
+    void createContext();
+    GpgKeyList listKeys(const QStringList &patterns);
+    void showCriticalMessage(const QString &title, const QString &text);
+    GpgContext *mGuiCtx; /** set for worker contexts only */
+    bool mShowErrorMessages;
+    QString mLastErrorString;
     gpgme_ctx_t mCtx;
     gpgme_data_t in, out;
     gpgme_error_t err;
-    gpgme_error_t readToBuffer(gpgme_data_t in, QByteArray *outBuffer);
+    bool encryptData(QStringList *uidList, gpgme_data_t in, gpgme_data_t out);
+    bool encryptData(gpgme_key_t recipients[], gpgme_data_t in, gpgme_data_t out);
+    bool decryptData(gpgme_data_t in, gpgme_data_t out, GpgSignatureList *signatures = NULL);
+    GpgImportInformation importData(gpgme_data_t in);
+    static GpgSignatureList signatureList(gpgme_verify_result_t result);
+    bool signData(QStringList *uidList, gpgme_data_t in, gpgme_data_t out, bool detached);
     QByteArray mPasswordCache;
     QSettings settings;
     bool debug;
-    GpgKeyList mKeyList;
+    GpgKeyStore mKeyStore;
+    KeySearchIndex *mKeySearchIndex;
+    GpgKeyCache *mKeyCache; /** owned by the gui context, shared with the workers */
+    QTimer *mKeyDBChangedTimer; /** gui context only */
+    QSet<QString> mChangedFprs;
+    bool mKeyDBReset; /** the whole keyring has to be reread */
+    /** ms without further changes, until they are applied */
+    static const int keyDBChangedDelay = 100;
+    /** more changed keys are not listed one by one, but by rereading the keyring */
+    static const int maxIncrementalKeys = 64;
     int checkErr(gpgme_error_t err) const;
     int checkErr(gpgme_error_t err, QString comment) const;
 
@@ -171,6 +340,10 @@ private:
     gpgme_error_t passphrase(const char *uid_hint,
                              const char *passphrase_info,
                              int last_was_bad, int fd);
+    static void progressCb(void *hook, const char *what, int type,
+                           int current, int total);
+    static void dataProgressCb(void *hook, qint64 current, qint64 total);
+    int mProgressPermille;
 
     void executeGpgCommand(QStringList arguments,
                            QByteArray *stdOut,
@@ -0,0 +1,75 @@
+/*
+ *      gpgcontextpool.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "gpgcontextpool.h"
+
+GpgContextPool::GpgContextPool(GpgME::GpgContext *ctx, int size)
+{
+    // create all contexts here, so they live in the thread of ctx
+    for (int i = 0; i < qMax(size, 1); i++) {
+        GpgME::GpgContext *workerCtx = new GpgME::GpgContext(ctx);
+        mContexts.append(workerCtx);
+        mFreeContexts.append(workerCtx);
+    }
+}
+
+GpgContextPool::~GpgContextPool()
+{
+    qDeleteAll(mContexts);
+}
+
+GpgME::GpgContext *GpgContextPool::acquire()
+{
+    QMutexLocker locker(&mMutex);
+    while (mFreeContexts.isEmpty()) {
+        mContextReleased.wait(&mMutex);
+    }
+    return mFreeContexts.takeLast();
+}
+
+void GpgContextPool::release(GpgME::GpgContext *ctx)
+{
+    QMutexLocker locker(&mMutex);
+    mFreeContexts.append(ctx);
+    mContextReleased.wakeOne();
+}
+
+void GpgContextPool::cancelAll()
+{
+    QMutexLocker locker(&mMutex);
+    foreach (GpgME::GpgContext *ctx, mContexts) {
+        if (!mFreeContexts.contains(ctx)) {
+            ctx->cancel();
+        }
+    }
+}
+
+void GpgContextPool::setShowErrorMessages(bool show)
+{
+    foreach (GpgME::GpgContext *ctx, mContexts) {
+        ctx->setShowErrorMessages(show);
+    }
+}
+
+int GpgContextPool::size() const
+{
+    return mContexts.size();
+}
@@ -0,0 +1,74 @@
+/*
+ *      gpgcontextpool.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __GPGCONTEXTPOOL_H__
+#define __GPGCONTEXTPOOL_H__
+
+#include "gpgcontext.h"
+#include <QMutex>
+#include <QWaitCondition>
+
+/**
+ * @brief A fixed number of worker contexts, which can be shared by the threads
+ * of a QThreadPool. Every thread acquires a context for an operation and releases
+ * it afterwards, so no two threads use the same gpgme-context at the same time.
+ */
+class GpgContextPool
+{
+public:
+    /**
+     * @param ctx The gui context, the worker contexts are created from it.
+     * @param size The number of worker contexts, e.g. QThread::idealThreadCount().
+     */
+    GpgContextPool(GpgME::GpgContext *ctx, int size);
+    ~GpgContextPool();
+
+    /**
+     * @details Get an unused context, blocks until one is available.
+     */
+    GpgME::GpgContext *acquire();
+
+    /**
+     * @details Give a context got by acquire() back to the pool.
+     */
+    void release(GpgME::GpgContext *ctx);
+
+    /**
+     * @details Cancel the operations running in all contexts of the pool.
+     */
+    void cancelAll();
+
+    /**
+     * @details Set whether the contexts show error messages, see
+     * GpgContext::setShowErrorMessages().
+     */
+    void setShowErrorMessages(bool show);
+
+    int size() const;
+
+private:
+    QList<GpgME::GpgContext *> mContexts;
+    QList<GpgME::GpgContext *> mFreeContexts;
+    QMutex mMutex;
+    QWaitCondition mContextReleased;
+};
+
+#endif // __GPGCONTEXTPOOL_H__
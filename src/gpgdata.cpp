@@ -0,0 +1,240 @@
+/*
+ *      gpgdata.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "gpgdata.h"
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+gpgme_data_cbs GpgData::mCallbacks = {
+    GpgData::readCb,
+    GpgData::writeCb,
+    GpgData::seekCb,
+    NULL
+};
+
+GpgData::GpgData(const QByteArray &inBuffer)
+{
+    mInBuffer = &inBuffer;
+    mOutBuffer = 0;
+    mDevice = 0;
+    mStart = 0;
+    create();
+}
+
+GpgData::GpgData(QByteArray *outBuffer)
+{
+    mInBuffer = 0;
+    mOutBuffer = outBuffer;
+    mDevice = 0;
+    mStart = outBuffer->size();
+    create();
+}
+
+GpgData::GpgData(QIODevice *device)
+{
+    mInBuffer = 0;
+    mOutBuffer = 0;
+    mDevice = device;
+    mStart = device->isSequential() ? 0 : device->pos();
+    create();
+}
+
+GpgData::~GpgData()
+{
+    if (mData) {
+        gpgme_data_release(mData);
+    }
+}
+
+void GpgData::create()
+{
+    mData = 0;
+    mPos = 0;
+    mProgressCb = 0;
+    mProgressHook = 0;
+    mErr = gpgme_data_new_from_cbs(&mData, &mCallbacks, this);
+    if (mErr) {
+        mData = 0;
+    }
+}
+
+gpgme_data_t GpgData::data() const
+{
+    return mData;
+}
+
+qint64 GpgData::size() const
+{
+    if (mInBuffer != 0) {
+        return mInBuffer->size() - mStart;
+    }
+    if (mOutBuffer != 0) {
+        return mOutBuffer->size() - mStart;
+    }
+    if (mDevice->isSequential()) {
+        return -1;
+    }
+    return mDevice->size() - mStart;
+}
+
+void GpgData::setSizeHint(qint64 size)
+{
+    if (mOutBuffer != 0 && size > 0 && mStart + size <= INT_MAX) {
+        mOutBuffer->reserve(mStart + size);
+    }
+}
+
+void GpgData::setProgressCallback(ProgressCb callback, void *hook)
+{
+    mProgressCb = callback;
+    mProgressHook = hook;
+}
+
+gpgme_error_t GpgData::error() const
+{
+    return mErr;
+}
+
+ssize_t GpgData::readCb(void *handle, void *buffer, size_t size)
+{
+    GpgData *d = static_cast<GpgData *>(handle);
+    ssize_t len = d->read(buffer, size);
+    if (len > 0 && d->mProgressCb != 0) {
+        d->mProgressCb(d->mProgressHook, d->mPos, d->size());
+    }
+    return len;
+}
+
+ssize_t GpgData::read(void *buffer, size_t size)
+{
+    if (mInBuffer != 0) {
+        qint64 available = mInBuffer->size() - mStart - mPos;
+        qint64 len = qMin(qint64(size), qMax(available, qint64(0)));
+        memcpy(buffer, mInBuffer->constData() + mStart + mPos, len);
+        mPos += len;
+        return len;
+    }
+
+    if (mOutBuffer != 0) {
+        qint64 available = mOutBuffer->size() - mStart - mPos;
+        qint64 len = qMin(qint64(size), qMax(available, qint64(0)));
+        memcpy(buffer, mOutBuffer->constData() + mStart + mPos, len);
+        mPos += len;
+        return len;
+    }
+
+    qint64 len = mDevice->read(static_cast<char *>(buffer), size);
+    if (len < 0) {
+        errno = EIO;
+        return -1;
+    }
+    mPos += len;
+    return len;
+}
+
+ssize_t GpgData::writeCb(void *handle, const void *buffer, size_t size)
+{
+    GpgData *d = static_cast<GpgData *>(handle);
+
+    if (d->mOutBuffer != 0) {
+        QByteArray *out = d->mOutBuffer;
+        qint64 pos = d->mStart + d->mPos;
+        qint64 needed = pos + size;
+        if (needed > INT_MAX) {
+            errno = EFBIG;
+            return -1;
+        }
+        // if the size hint was too small, at least double the capacity,
+        // so the data is copied only a few times for large outputs
+        if (needed > out->capacity()) {
+            out->reserve(int(qMin(qMax(needed, qint64(out->capacity()) * 2), qint64(INT_MAX))));
+        }
+        if (pos == out->size()) {
+            out->append(static_cast<const char *>(buffer), size);
+        } else {
+            if (pos + qint64(size) > out->size()) {
+                out->resize(pos + size);
+            }
+            memcpy(out->data() + pos, buffer, size);
+        }
+        d->mPos += size;
+        return size;
+    }
+
+    if (d->mDevice != 0) {
+        qint64 len = d->mDevice->write(static_cast<const char *>(buffer), size);
+        if (len < 0) {
+            errno = EIO;
+            return -1;
+        }
+        d->mPos += len;
+        return len;
+    }
+
+    // the input buffer is read only
+    errno = EBADF;
+    return -1;
+}
+
+off_t GpgData::seekCb(void *handle, off_t offset, int whence)
+{
+    GpgData *d = static_cast<GpgData *>(handle);
+    qint64 size;
+
+    if (d->mInBuffer != 0) {
+        size = d->mInBuffer->size() - d->mStart;
+    } else if (d->mOutBuffer != 0) {
+        size = d->mOutBuffer->size() - d->mStart;
+    } else if (!d->mDevice->isSequential()) {
+        size = d->mDevice->size() - d->mStart;
+    } else {
+        errno = ESPIPE;
+        return -1;
+    }
+
+    qint64 pos;
+    switch (whence) {
+    case SEEK_SET:
+        pos = offset;
+        break;
+    case SEEK_CUR:
+        pos = d->mPos + offset;
+        break;
+    case SEEK_END:
+        pos = size + offset;
+        break;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+    if (pos < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (d->mDevice != 0 && !d->mDevice->seek(d->mStart + pos)) {
+        errno = EIO;
+        return -1;
+    }
+    d->mPos = pos;
+    return pos;
+}
@@ -0,0 +1,108 @@
+/*
+ *      gpgdata.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __GPGDATA_H__
+#define __GPGDATA_H__
+
+#include <gpgme.h>
+#include <QByteArray>
+#include <QIODevice>
+
+/**
+ * @brief gpgme data object, which reads from and writes to Qt buffers and devices
+ * through callbacks, so the data is not copied into a buffer of gpgme first.
+ *
+ * @details The buffer or device passed to the constructor has to live as long
+ * as the GpgData object, which releases the gpgme data object on destruction.
+ */
+class GpgData
+{
+public:
+    /**
+     * @details Called after every read, with the bytes read so far and size().
+     */
+    typedef void (*ProgressCb)(void *hook, qint64 current, qint64 total);
+
+    /**
+     * @details Read from inBuffer, without copying it.
+     */
+    explicit GpgData(const QByteArray &inBuffer);
+
+    /**
+     * @details Write to outBuffer, output is appended to the current content.
+     */
+    explicit GpgData(QByteArray *outBuffer);
+
+    /**
+     * @details Read from or write to device, starting at its current position.
+     */
+    explicit GpgData(QIODevice *device);
+
+    ~GpgData();
+
+    gpgme_data_t data() const;
+
+    /**
+     * @return The size of the data to read, or -1 if it is not known
+     * (e.g. for sequential devices)
+     */
+    qint64 size() const;
+
+    /**
+     * @details For output buffers, reserve room for size bytes of output,
+     * so the buffer doesn't have to grow while gpgme writes.
+     */
+    void setSizeHint(qint64 size);
+
+    /**
+     * @details Report how much of the input gpgme has read, e.g. for a progress
+     * bar while a large file is imported.
+     */
+    void setProgressCallback(ProgressCb callback, void *hook);
+
+    /**
+     * @return The error of creating the gpgme data object
+     */
+    gpgme_error_t error() const;
+
+private:
+    Q_DISABLE_COPY(GpgData)
+
+    void create();
+    ssize_t read(void *buffer, size_t size);
+    static ssize_t readCb(void *handle, void *buffer, size_t size);
+    static ssize_t writeCb(void *handle, const void *buffer, size_t size);
+    static off_t seekCb(void *handle, off_t offset, int whence);
+
+    static gpgme_data_cbs mCallbacks;
+
+    gpgme_data_t mData;
+    gpgme_error_t mErr;
+    const QByteArray *mInBuffer;
+    QByteArray *mOutBuffer;
+    QIODevice *mDevice;
+    qint64 mStart; /** position, where the data begins in buffer or device */
+    qint64 mPos;
+    ProgressCb mProgressCb;
+    void *mProgressHook;
+};
+
+#endif // __GPGDATA_H__
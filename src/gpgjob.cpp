@@ -0,0 +1,284 @@
+/*
+ *      gpgjob.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "gpgjob.h"
+#include "mimeencoder.h"
+
+GpgJob::GpgJob(GpgME::GpgContext *ctx, Operation operation, QObject *parent)
+    : QThread(parent)
+{
+    mCtx = new GpgME::GpgContext(ctx);
+    mOperation = operation;
+    mSuccess = false;
+    mCanceled = false;
+
+    connect(mCtx, SIGNAL(signalProgress(int,int)), this, SIGNAL(signalProgress(int,int)));
+}
+
+GpgJob::~GpgJob()
+{
+    wait();
+    delete mCtx;
+}
+
+void GpgJob::setKeys(const QStringList &uidList)
+{
+    mUidList = uidList;
+}
+
+void GpgJob::setInput(const QByteArray &inBuffer)
+{
+    mInBuffer = inBuffer;
+}
+
+void GpgJob::setFiles(const QString &inFileName, const QString &outFileName)
+{
+    mInFileName = inFileName;
+    mOutFileName = outFileName;
+}
+
+void GpgJob::setSignedFiles(const QString &inFileName, const QString &sigFileName)
+{
+    mInFileName = inFileName;
+    mSigFileName = sigFileName;
+}
+
+void GpgJob::setAttachments(const QStringList &fileNames, const QString &outFileName)
+{
+    mFileNames = fileNames;
+    mOutFileName = outFileName;
+}
+
+void GpgJob::setImportFiles(const QStringList &fileNames)
+{
+    mFileNames = fileNames;
+}
+
+GpgJob::Operation GpgJob::operation() const
+{
+    return mOperation;
+}
+
+QByteArray GpgJob::output() const
+{
+    return mOutBuffer;
+}
+
+GpgSignatureList GpgJob::signatures() const
+{
+    return mSignatures;
+}
+
+GpgImportInformation GpgJob::importInformation() const
+{
+    return mImportInformation;
+}
+
+QString GpgJob::inFileName() const
+{
+    return mInFileName;
+}
+
+QString GpgJob::outFileName() const
+{
+    return mOutFileName;
+}
+
+QString GpgJob::sigFileName() const
+{
+    return mSigFileName;
+}
+
+QByteArray GpgJob::input() const
+{
+    return mInBuffer;
+}
+
+QString GpgJob::errorString() const
+{
+    return mErrorString;
+}
+
+bool GpgJob::isSuccessful() const
+{
+    return mSuccess;
+}
+
+bool GpgJob::isCanceled() const
+{
+    return mCanceled;
+}
+
+void GpgJob::slotCancel()
+{
+    mCanceled = true;
+    mCtx->cancel();
+}
+
+void GpgJob::run()
+{
+    switch (mOperation) {
+    case Encrypt:
+        mSuccess = mCtx->encrypt(&mUidList, mInBuffer, &mOutBuffer);
+        break;
+    case Decrypt:
+        mSuccess = mCtx->decryptVerify(mInBuffer, &mOutBuffer, &mSignatures);
+        break;
+    case Sign:
+        mSuccess = mCtx->sign(&mUidList, mInBuffer, &mOutBuffer);
+        break;
+    case VerifyFile:
+        mSuccess = runVerifyFile();
+        break;
+    case EncryptMime:
+        mSuccess = runEncryptMime();
+        break;
+    case ImportFiles:
+        mSuccess = runImportFiles();
+        break;
+    default:
+        mSuccess = runFileOperation();
+        break;
+    }
+
+    // the input is not needed anymore, free it as early as possible
+    if (mOperation != Decrypt) {
+        mInBuffer.clear();
+    }
+}
+
+bool GpgJob::runFileOperation()
+{
+    QFile inFile(mInFileName);
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        mErrorString = tr("Cannot read file %1:\n%2.").arg(mInFileName).arg(inFile.errorString());
+        return false;
+    }
+
+    // gpgme writes directly to the file descriptor, so no buffering by QFile
+    QFile outFile(mOutFileName);
+    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        mErrorString = tr("Cannot write file %1:\n%2.").arg(mOutFileName).arg(outFile.errorString());
+        return false;
+    }
+
+    bool success = false;
+    if (mOperation == EncryptFile) {
+        success = mCtx->encryptFile(&mUidList, &inFile, &outFile);
+    } else if (mOperation == DecryptFile) {
+        success = mCtx->decryptFile(&inFile, &outFile);
+    } else if (mOperation == SignFile) {
+        success = mCtx->signFile(&mUidList, &inFile, &outFile);
+    }
+
+    inFile.close();
+    outFile.close();
+
+    // don't leave a partially written file behind
+    if (!success) {
+        outFile.remove();
+    }
+    return success;
+}
+
+/** Only the detached signature is read into memory, the signed
+ *  file is streamed to gpg, so it may be larger than memory.
+ */
+bool GpgJob::runVerifyFile()
+{
+    QFile sigFile(mSigFileName);
+    if (!sigFile.open(QIODevice::ReadOnly)) {
+        mErrorString = tr("Cannot read file %1:\n%2.").arg(mSigFileName).arg(sigFile.errorString());
+        return false;
+    }
+    QByteArray sigBuffer = sigFile.readAll();
+    sigFile.close();
+
+    QFile inFile(mInFileName);
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        mErrorString = tr("Cannot read file %1:\n%2.").arg(mInFileName).arg(inFile.errorString());
+        return false;
+    }
+
+    mSignatures = mCtx->verifyFile(&inFile, sigBuffer);
+    inFile.close();
+    return !mSignatures.isEmpty();
+}
+
+/** The message is encoded while gpg reads it, so neither the
+ *  attachments nor the encoded message are held in memory.
+ */
+bool GpgJob::runEncryptMime()
+{
+    MimeEncoder message(mInBuffer, mFileNames);
+    if (!message.open(QIODevice::ReadOnly)) {
+        mErrorString = message.errorString();
+        return false;
+    }
+
+    QFile outFile(mOutFileName);
+    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        mErrorString = tr("Cannot write file %1:\n%2.").arg(mOutFileName).arg(outFile.errorString());
+        return false;
+    }
+
+    bool success = mCtx->encryptDevice(&mUidList, &message, &outFile);
+    if (message.hasError()) {
+        mErrorString = message.errorString();
+        success = false;
+    }
+
+    message.close();
+    outFile.close();
+
+    // don't leave a partially written file behind
+    if (!success) {
+        outFile.remove();
+    }
+    return success;
+}
+
+/** The files are streamed to gpg, the keylist is refreshed only
+ *  once after the last file, instead of after every file.
+ */
+bool GpgJob::runImportFiles()
+{
+    bool success = true;
+    foreach (QString fileName, mFileNames) {
+        if (mCanceled) {
+            break;
+        }
+        QFile inFile(fileName);
+        if (!inFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            mErrorString = tr("Cannot read file %1:\n%2.").arg(fileName).arg(inFile.errorString());
+            success = false;
+            continue;
+        }
+        mImportInformation += mCtx->importKeyFile(&inFile);
+        inFile.close();
+    }
+
+    QStringList fprs = mImportInformation.changedFingerprints();
+    if (!fprs.isEmpty()) {
+        mCtx->notifyKeyDBChanged(fprs);
+    }
+    return success && !mCanceled;
+}
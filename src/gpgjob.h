@@ -0,0 +1,154 @@
+/*
+ *      gpgjob.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __GPGJOB_H__
+#define __GPGJOB_H__
+
+#include "gpgcontext.h"
+#include <QThread>
+
+/**
+ * @brief Runs a crypto operation in its own thread with an own gpgme-context,
+ * so that the gui stays responsive while big payloads are processed.
+ *
+ * Configure the job with setKeys(), setInput() or setFiles() and start() it.
+ * The result can be read, when the finished() signal is emitted.
+ */
+class GpgJob : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum Operation {
+        Encrypt,
+        Decrypt,
+        Sign,
+        EncryptFile,
+        DecryptFile,
+        SignFile,
+        VerifyFile,
+        EncryptMime,
+        ImportFiles
+    };
+
+    /**
+     * @param ctx The gui context, the job creates a worker context from it.
+     * @param operation The operation to run.
+     * @param parent The parent object.
+     */
+    GpgJob(GpgME::GpgContext *ctx, Operation operation, QObject *parent = 0);
+    ~GpgJob();
+
+    /**
+     * @details Set the keys to encrypt for or to sign with.
+     */
+    void setKeys(const QStringList &uidList);
+
+    /**
+     * @details Set the data for Encrypt, Decrypt and Sign.
+     */
+    void setInput(const QByteArray &inBuffer);
+
+    /**
+     * @details Set the files for EncryptFile, DecryptFile and SignFile.
+     */
+    void setFiles(const QString &inFileName, const QString &outFileName);
+
+    /**
+     * @details Set the signed file and its detached signature for VerifyFile.
+     */
+    void setSignedFiles(const QString &inFileName, const QString &sigFileName);
+
+    /**
+     * @details Set the files, which are attached to the input text for EncryptMime,
+     * and the file to write the encrypted message to.
+     */
+    void setAttachments(const QStringList &fileNames, const QString &outFileName);
+
+    /**
+     * @details Set the keyring or key files for ImportFiles.
+     */
+    void setImportFiles(const QStringList &fileNames);
+
+    Operation operation() const;
+    QByteArray output() const;
+    /**
+     * @details Signatures of the decrypted text, Decrypt verifies in the same pass,
+     * or of the file for VerifyFile.
+     */
+    GpgSignatureList signatures() const;
+    /**
+     * @details Summed up result of all files for ImportFiles.
+     */
+    GpgImportInformation importInformation() const;
+    QString inFileName() const;
+    QString outFileName() const;
+    QString sigFileName() const;
+    /**
+     * @details The input of Decrypt, it is kept, so the signatures can be
+     * verified again after a missing key is imported.
+     */
+    QByteArray input() const;
+    /**
+     * @details Description of file errors, other errors are shown by the context.
+     */
+    QString errorString() const;
+    bool isSuccessful() const;
+    bool isCanceled() const;
+
+public slots:
+    /**
+     * @details Cancel the running operation.
+     */
+    void slotCancel();
+
+signals:
+    /**
+     * @details Progress of the operation as reported by gpg.
+     */
+    void signalProgress(int current, int total);
+
+protected:
+    void run();
+
+private:
+    bool runFileOperation();
+    bool runVerifyFile();
+    bool runEncryptMime();
+    bool runImportFiles();
+
+    GpgME::GpgContext *mCtx; /** the worker context */
+    Operation mOperation;
+    QStringList mUidList;
+    QByteArray mInBuffer;
+    QByteArray mOutBuffer;
+    GpgSignatureList mSignatures;
+    QString mInFileName;
+    QString mOutFileName;
+    QString mSigFileName;
+    QStringList mFileNames; /** attachments or files to import */
+    GpgImportInformation mImportInformation;
+    QString mErrorString;
+    bool mSuccess;
+    volatile bool mCanceled;
+};
+
+#endif // __GPGJOB_H__
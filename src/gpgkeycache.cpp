@@ -0,0 +1,58 @@
+/*
+ *      gpgkeycache.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "gpgkeycache.h"
+
+GpgKeyCache::~GpgKeyCache()
+{
+    clear();
+}
+
+gpgme_key_t GpgKeyCache::key(gpgme_ctx_t ctx, const QString &uid)
+{
+    QMutexLocker locker(&mMutex);
+
+    gpgme_key_t key = mKeys.value(uid, NULL);
+    if (key == NULL) {
+        // the last 0 is for public keys, 1 would return private keys
+        gpgme_op_keylist_start(ctx, uid.toAscii().constData(), 0);
+        gpgme_op_keylist_next(ctx, &key);
+        gpgme_op_keylist_end(ctx);
+        if (key == NULL) {
+            return NULL;
+        }
+        // this reference is owned by the cache
+        mKeys.insert(uid, key);
+    }
+
+    gpgme_key_ref(key);
+    return key;
+}
+
+void GpgKeyCache::clear()
+{
+    QMutexLocker locker(&mMutex);
+
+    foreach (gpgme_key_t key, mKeys) {
+        gpgme_key_unref(key);
+    }
+    mKeys.clear();
+}
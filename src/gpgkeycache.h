@@ -0,0 +1,61 @@
+/*
+ *      gpgkeycache.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __GPGKEYCACHE_H__
+#define __GPGKEYCACHE_H__
+
+#include <gpgme.h>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief Cache of gpgme key handles by uid, so encrypting or signing again
+ * for the same keys doesn't ask the gpg engine for every key.
+ *
+ * @details The cache is shared by the gui context and its worker contexts,
+ * so all access is locked. The keys are reference counted, every key returned
+ * by key() has to be released with gpgme_key_unref.
+ */
+class GpgKeyCache
+{
+public:
+    ~GpgKeyCache();
+
+    /**
+     * @details Get the public key for uid, a miss is looked up with ctx,
+     * which has to belong to the calling thread.
+     *
+     * @return The key with an own reference, or NULL if it is not in the keyring
+     */
+    gpgme_key_t key(gpgme_ctx_t ctx, const QString &uid);
+
+    /**
+     * @details Drop all keys, has to be called when the keyring changes.
+     */
+    void clear();
+
+private:
+    QMutex mMutex;
+    QHash<QString, gpgme_key_t> mKeys;
+};
+
+#endif // __GPGKEYCACHE_H__
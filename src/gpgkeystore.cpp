@@ -0,0 +1,230 @@
+/*
+ *      gpgkeystore.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "gpgkeystore.h"
+#include <QSet>
+
+GpgKeyStore::GpgKeyStore(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void GpgKeyStore::insert(const GpgKey &key)
+{
+    QHash<QString, int>::const_iterator it = mFprIndex.constFind(key.fpr);
+    if (it != mFprIndex.constEnd()) {
+        int index = it.value();
+        if (mKeys.at(index) == key) {
+            return;
+        }
+        removeFromIndex(index);
+        mKeys[index] = key;
+        addToIndex(index);
+        emit signalKeyChanged(index);
+        return;
+    }
+
+    int index = mKeys.size();
+    mKeys.append(key);
+    addToIndex(index);
+    emit signalKeyInserted(index);
+}
+
+bool GpgKeyStore::remove(const QString &fpr)
+{
+    QHash<QString, int>::const_iterator it = mFprIndex.constFind(fpr);
+    if (it == mFprIndex.constEnd()) {
+        return false;
+    }
+
+    int index = it.value();
+    int last = mKeys.size() - 1;
+    removeFromIndex(index);
+    if (index != last) {
+        // the last key is now in two places, until it is removed below
+        removeFromIndex(last);
+        mKeys[index] = mKeys.at(last);
+        addToIndex(index);
+        emit signalKeyChanged(index);
+    }
+    emit signalKeyAboutToBeRemoved(last);
+    mKeys.remove(last);
+    emit signalKeyRemoved(last);
+    return true;
+}
+
+void GpgKeyStore::sync(const GpgKeyList &keys)
+{
+    QSet<QString> fprs;
+    fprs.reserve(keys.size());
+    int changes = 0;
+    foreach (const GpgKey &key, keys) {
+        fprs.insert(key.fpr);
+        const GpgKey *stored = findByFpr(key.fpr);
+        if (stored == NULL || *stored != key) {
+            changes++;
+        }
+    }
+    foreach (const GpgKey &key, mKeys) {
+        if (!fprs.contains(key.fpr)) {
+            changes++;
+        }
+    }
+
+    if (changes > maxSignaledChanges) {
+        reset(keys);
+        return;
+    }
+
+    // iterate backwards, remove() moves the last key, which is already checked
+    for (int i = mKeys.size() - 1; i >= 0; i--) {
+        if (!fprs.contains(mKeys.at(i).fpr)) {
+            remove(mKeys.at(i).fpr);
+        }
+    }
+
+    mKeys.reserve(keys.size());
+    foreach (const GpgKey &key, keys) {
+        insert(key);
+    }
+}
+
+void GpgKeyStore::clear()
+{
+    reset(GpgKeyList());
+}
+
+void GpgKeyStore::reset(const GpgKeyList &keys)
+{
+    emit signalAboutToBeReset();
+    mKeys.clear();
+    mFprIndex.clear();
+    mIdIndex.clear();
+    mEmailIndex.clear();
+
+    mKeys.reserve(keys.size());
+    foreach (const GpgKey &key, keys) {
+        // a key listed twice replaces the first one, like insert()
+        int index = mFprIndex.value(key.fpr, -1);
+        if (index != -1) {
+            removeFromIndex(index);
+            mKeys[index] = key;
+        } else {
+            index = mKeys.size();
+            mKeys.append(key);
+        }
+        addToIndex(index);
+    }
+    emit signalReset();
+}
+
+int GpgKeyStore::size() const
+{
+    return mKeys.size();
+}
+
+const GpgKey &GpgKeyStore::at(int index) const
+{
+    return mKeys.at(index);
+}
+
+const GpgKey *GpgKeyStore::findByFpr(const QString &fpr) const
+{
+    QHash<QString, int>::const_iterator it = mFprIndex.constFind(fpr);
+    if (it == mFprIndex.constEnd()) {
+        return NULL;
+    }
+    return &mKeys.at(it.value());
+}
+
+const GpgKey *GpgKeyStore::findById(const QString &id) const
+{
+    QHash<QString, int>::const_iterator it = mIdIndex.constFind(id);
+    if (it == mIdIndex.constEnd()) {
+        return NULL;
+    }
+    return &mKeys.at(it.value());
+}
+
+QList<const GpgKey *> GpgKeyStore::findByEmail(const QString &email) const
+{
+    QList<const GpgKey *> result;
+    foreach (int index, mEmailIndex.values(email.toLower())) {
+        result.append(&mKeys.at(index));
+    }
+    return result;
+}
+
+const GpgKey *GpgKeyStore::findByName(const QString &name, bool secret) const
+{
+    if (name.contains('@')) {
+        foreach (const GpgKey *key, findByEmail(name)) {
+            if (!secret || key->privkey) {
+                return key;
+            }
+        }
+        return NULL;
+    }
+
+    QString id = name.toUpper();
+    if (id.startsWith("0X")) {
+        id.remove(0, 2);
+    }
+    id.remove(' ');
+
+    const GpgKey *key = findByFpr(id);
+    if (key == NULL) {
+        key = findById(id);
+    }
+    // short key ids are not indexed, they are rarely used
+    if (key == NULL && id.size() == 8) {
+        for (int i = 0; i < mKeys.size(); i++) {
+            if (mKeys.at(i).id.endsWith(id)) {
+                key = &mKeys.at(i);
+                break;
+            }
+        }
+    }
+    if (key != NULL && secret && !key->privkey) {
+        return NULL;
+    }
+    return key;
+}
+
+void GpgKeyStore::addToIndex(int index)
+{
+    const GpgKey &key = mKeys.at(index);
+    mFprIndex.insert(key.fpr, index);
+    mIdIndex.insert(key.id, index);
+    if (!key.email.isEmpty()) {
+        mEmailIndex.insert(key.email.toLower(), index);
+    }
+}
+
+void GpgKeyStore::removeFromIndex(int index)
+{
+    const GpgKey &key = mKeys.at(index);
+    mFprIndex.remove(key.fpr);
+    mIdIndex.remove(key.id);
+    if (!key.email.isEmpty()) {
+        mEmailIndex.remove(key.email.toLower(), index);
+    }
+}
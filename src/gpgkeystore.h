@@ -0,0 +1,149 @@
+/*
+ *      gpgkeystore.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __GPGKEYSTORE_H__
+#define __GPGKEYSTORE_H__
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QString>
+
+class GpgKey
+{
+public:
+    GpgKey() {
+        privkey = false;
+        expired = false;
+        revoked = false;
+    }
+    QString id;
+    QString name;
+    QString email;
+    QString fpr;
+    bool privkey;
+    bool expired;
+    bool revoked;
+
+    bool operator==(const GpgKey &other) const {
+        return id == other.id && name == other.name && email == other.email
+               && fpr == other.fpr && privkey == other.privkey
+               && expired == other.expired && revoked == other.revoked;
+    }
+    bool operator!=(const GpgKey &other) const {
+        return !(*this == other);
+    }
+};
+
+typedef QVector< GpgKey > GpgKeyList;
+
+/**
+ * @brief Keeps the keys of the keyring in contiguous storage, with hash indexes
+ * by fingerprint, key id and email.
+ *
+ * @details Removing a key moves the last key to its place, so the indexes of
+ * all other keys stay valid and every operation except sync() is O(1).
+ *
+ * Every change is reported by the signals, so models can follow the store row
+ * by row (the index of a key is its row) instead of being rebuilt. Only when many
+ * keys change at once, e.g. after importing a keyring, the store is reset and
+ * the models are rebuilt once.
+ */
+class GpgKeyStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    GpgKeyStore(QObject *parent = 0);
+
+    /**
+     * @details Add the key, or replace the key with the same fingerprint.
+     */
+    void insert(const GpgKey &key);
+
+    /**
+     * @details Remove the key with fingerprint fpr.
+     *
+     * @return false, if no such key is stored
+     */
+    bool remove(const QString &fpr);
+
+    /**
+     * @details Bring the store in line with keys: keys not in the list are removed,
+     * all others are inserted or replaced. Only changed keys are signaled, unless
+     * more than maxSignaledChanges keys differ, then the store is reset to keys.
+     */
+    void sync(const GpgKeyList &keys);
+
+    void clear();
+    int size() const;
+    const GpgKey &at(int index) const;
+
+    /**
+     * @return The key with the fingerprint fpr, or NULL
+     */
+    const GpgKey *findByFpr(const QString &fpr) const;
+
+    /**
+     * @return The key with the (long) key id, or NULL
+     */
+    const GpgKey *findById(const QString &id) const;
+
+    /**
+     * @return All keys with email as primary email address, compared case-insensitive
+     */
+    QList<const GpgKey *> findByEmail(const QString &email) const;
+
+    /**
+     * @details Find a key by a name given by the user: a fingerprint, a long or
+     * short key id (optionally with 0x), or an email address. If secret is set,
+     * only keys with a private key are found.
+     *
+     * @return The key, or NULL
+     */
+    const GpgKey *findByName(const QString &name, bool secret = false) const;
+
+signals:
+    void signalKeyInserted(int index);
+    void signalKeyChanged(int index);
+    void signalKeyAboutToBeRemoved(int index);
+    void signalKeyRemoved(int index);
+    /**
+     * @details All keys are replaced, by clear() or a sync() with many changes.
+     * Indexes of the keys are not kept, followers have to rebuild from the store.
+     */
+    void signalAboutToBeReset();
+    void signalReset();
+
+private:
+    void reset(const GpgKeyList &keys);
+    void addToIndex(int index);
+    void removeFromIndex(int index);
+
+    QVector<GpgKey> mKeys;
+    QHash<QString, int> mFprIndex;
+    QHash<QString, int> mIdIndex;
+    QMultiHash<QString, int> mEmailIndex;
+    /** signaling more changes row by row costs more than rebuilding the followers */
+    static const int maxSignaledChanges = 64;
+};
+
+#endif // __GPGKEYSTORE_H__
@@ -0,0 +1,321 @@
+/*
+ *      gpgserver.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "gpgserver.h"
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+static const char *const operationNames[] = {
+    "encrypt", "decrypt", "sign", "verify", "stats"
+};
+
+static const int maxHeaderSize = 64 * 1024;
+static const int maxRequestSize = 256 * 1024 * 1024;
+
+GpgServer::GpgServer(GpgME::GpgContext *ctx, QObject *parent)
+    : QObject(parent)
+{
+    mCtx = ctx;
+    mPool = new GpgContextPool(ctx, QThread::idealThreadCount());
+    mPool->setShowErrorMessages(false);
+    mThreadPool.setMaxThreadCount(mPool->size());
+    mNextConnectionId = 1;
+    mPendingCount = 0;
+    mClock.start();
+
+    connect(&mServer, SIGNAL(newConnection()), this, SLOT(slotNewConnection()));
+}
+
+GpgServer::~GpgServer()
+{
+    mServer.close();
+    mThreadPool.waitForDone();
+    delete mPool;
+}
+
+bool GpgServer::listen(const QString &name)
+{
+#ifndef _WIN32
+    // the socket file gets the permissions of the umask, other users
+    // must not use the keys unlocked by the password
+    mode_t oldMask = umask(077);
+#endif
+    bool listening = mServer.listen(name);
+    if (!listening && mServer.serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket socket;
+        socket.connectToServer(name);
+        if (!socket.waitForConnected(1000)) {
+            QLocalServer::removeServer(name);
+            listening = mServer.listen(name);
+        }
+    }
+#ifndef _WIN32
+    umask(oldMask);
+#endif
+    return listening;
+}
+
+QString GpgServer::errorString() const
+{
+    return mServer.errorString();
+}
+
+QByteArray GpgServer::statistics() const
+{
+    QByteArray stats;
+    for (int i = 0; i < Stats; i++) {
+        const Metrics &metrics = mMetrics[i];
+        double mean = metrics.count > 0 ? double(metrics.totalLatency) / metrics.count : 0;
+        stats += QByteArray(operationNames[i])
+                 + " count=" + QByteArray::number(metrics.count)
+                 + " failed=" + QByteArray::number(metrics.failed)
+                 + " mean_ms=" + QByteArray::number(mean, 'f', 1)
+                 + " max_ms=" + QByteArray::number(metrics.maxLatency) + "\n";
+    }
+    stats += "pending=" + QByteArray::number(mPendingCount) + "\n";
+    return stats;
+}
+
+void GpgServer::slotNewConnection()
+{
+    while (mServer.hasPendingConnections()) {
+        QLocalSocket *socket = mServer.nextPendingConnection();
+        int connectionId = mNextConnectionId++;
+        socket->setProperty("connectionId", connectionId);
+        mSockets.insert(connectionId, socket);
+        mRequests.insert(socket, GpgServerRequest());
+
+        connect(socket, SIGNAL(readyRead()), this, SLOT(slotReadyRead()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(slotDisconnected()));
+    }
+}
+
+/** Responses of requests, which are still running, are dropped
+ */
+void GpgServer::slotDisconnected()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    mSockets.remove(socket->property("connectionId").toInt());
+    mRequests.remove(socket);
+    socket->deleteLater();
+}
+
+/** Read all complete requests, the rest stays in the buffer of
+ *  the socket until more data arrives
+ */
+void GpgServer::slotReadyRead()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if (!mRequests.contains(socket)) {
+        // closed after a malformed request
+        return;
+    }
+
+    forever {
+        GpgServerRequest &request = mRequests[socket];
+        if (request.length < 0) {
+            QByteArray error;
+            if (!readHeader(socket, &request, &error)) {
+                if (!error.isEmpty()) {
+                    sendResponse(socket, request.id.isEmpty() ? "-" : request.id, false, error, 0);
+                    mRequests.remove(socket);
+                    socket->disconnectFromServer();
+                }
+                return;
+            }
+        }
+        if (socket->bytesAvailable() < request.length) {
+            return;
+        }
+
+        request.data = socket->read(request.length);
+        request.started = mClock.elapsed();
+        runRequest(request);
+        mRequests.insert(socket, GpgServerRequest());
+    }
+}
+
+/** Parse the header line of a request and resolve the key names,
+ *  returns false if the line is not complete or malformed (error is set)
+ */
+bool GpgServer::readHeader(QLocalSocket *socket, GpgServerRequest *request, QByteArray *error)
+{
+    if (!socket->canReadLine()) {
+        if (socket->bytesAvailable() > maxHeaderSize) {
+            *error = "header too long";
+        }
+        return false;
+    }
+    QByteArray line = socket->readLine(maxHeaderSize + 1);
+    if (!line.endsWith('\n')) {
+        *error = "header too long";
+        return false;
+    }
+
+    QList<QByteArray> fields = line.simplified().split(' ');
+    if (fields.size() < 3) {
+        *error = "malformed header";
+        return false;
+    }
+    request->id = fields.at(0);
+
+    request->operation = -1;
+    for (int i = 0; i <= Stats; i++) {
+        if (fields.at(1) == operationNames[i]) {
+            request->operation = i;
+        }
+    }
+    bool ok;
+    int length = fields.at(2).toInt(&ok);
+    if (request->operation < 0 || !ok || length < 0 || length > maxRequestSize) {
+        *error = "malformed header";
+        return false;
+    }
+    request->length = length;
+    request->connectionId = socket->property("connectionId").toInt();
+
+    // the keydb is only read in this thread, the worker contexts get the key ids
+    for (int i = 3; i < fields.size(); i++) {
+        const GpgKey *key = mCtx->keyStore()->findByName(QString::fromUtf8(fields.at(i)),
+                                                         request->operation == Sign);
+        if (key == 0) {
+            request->error = "no key found for " + fields.at(i);
+            break;
+        }
+        request->uidList.append(key->id);
+    }
+    if ((request->operation == Encrypt || request->operation == Sign)
+            && request->uidList.isEmpty() && request->error.isEmpty()) {
+        request->error = "no key given";
+    }
+    return true;
+}
+
+void GpgServer::runRequest(const GpgServerRequest &request)
+{
+    mPendingCount++;
+    if (!request.error.isEmpty()) {
+        slotRequestFinished(request.connectionId, request.id, request.operation,
+                            request.started, false, request.error);
+    } else if (request.operation == Stats) {
+        slotRequestFinished(request.connectionId, request.id, request.operation,
+                            request.started, true, statistics());
+    } else {
+        mThreadPool.start(new GpgServerTask(this, request));
+    }
+}
+
+void GpgServer::slotRequestFinished(int connectionId, QByteArray id, int operation,
+                                    int started, bool success, QByteArray result)
+{
+    mPendingCount--;
+
+    int latency = mClock.elapsed() - started;
+    if (latency < 0) {
+        // the clock wraps after a day
+        latency += 24 * 60 * 60 * 1000;
+    }
+    if (operation < Stats) {
+        Metrics &metrics = mMetrics[operation];
+        metrics.count++;
+        if (!success) {
+            metrics.failed++;
+        }
+        metrics.totalLatency += latency;
+        metrics.maxLatency = qMax(metrics.maxLatency, latency);
+    }
+
+    QLocalSocket *socket = mSockets.value(connectionId);
+    if (socket != 0) {
+        sendResponse(socket, id, success, result, latency);
+    }
+}
+
+void GpgServer::sendResponse(QLocalSocket *socket, const QByteArray &id, bool success,
+                             const QByteArray &result, int latency)
+{
+    QByteArray header = id + (success ? " OK " : " ERROR ")
+                        + QByteArray::number(result.size()) + " "
+                        + QByteArray::number(latency) + "\n";
+    socket->write(header);
+    socket->write(result);
+}
+
+GpgServerTask::GpgServerTask(GpgServer *server, const GpgServerRequest &request)
+{
+    mServer = server;
+    mRequest = request;
+}
+
+/** Called in a thread of the threadpool, the result is passed to
+ *  the thread of the server by a queued call of slotRequestFinished
+ */
+void GpgServerTask::run()
+{
+    GpgME::GpgContext *ctx = mServer->mPool->acquire();
+    ctx->clearLastError();
+
+    QByteArray result;
+    bool success = false;
+    switch (mRequest.operation) {
+    case GpgServer::Encrypt:
+        success = ctx->encrypt(&mRequest.uidList, mRequest.data, &result);
+        break;
+    case GpgServer::Decrypt: {
+        GpgSignatureList signatures;
+        success = ctx->decryptVerify(mRequest.data, &result, &signatures);
+        break;
+    }
+    case GpgServer::Sign:
+        success = ctx->sign(&mRequest.uidList, mRequest.data, &result);
+        break;
+    case GpgServer::Verify: {
+        GpgSignatureList signatures = ctx->verify(&mRequest.data);
+        success = !signatures.isEmpty();
+        foreach (const GpgSignature &signature, signatures) {
+            if (signature.status == GPG_ERR_NO_ERROR) {
+                result += "GOOD " + signature.fpr.toUtf8() + "\n";
+            } else {
+                result += "BAD " + signature.fpr.toUtf8() + " "
+                          + GpgME::GpgContext::gpgErrString(signature.status).toUtf8() + "\n";
+                success = false;
+            }
+        }
+        break;
+    }
+    }
+
+    // on errors the result is the error message, only verify lists the bad signatures
+    if (!success && (result.isEmpty() || mRequest.operation != GpgServer::Verify)) {
+        QString error = ctx->lastErrorString();
+        result = error.isEmpty() ? QByteArray("failed") : error.toUtf8();
+    }
+    mServer->mPool->release(ctx);
+
+    // the data is not needed anymore, free it before waiting for the gui thread
+    mRequest.data.clear();
+
+    QMetaObject::invokeMethod(mServer, "slotRequestFinished", Qt::QueuedConnection,
+                              Q_ARG(int, mRequest.connectionId), Q_ARG(QByteArray, mRequest.id),
+                              Q_ARG(int, mRequest.operation), Q_ARG(int, mRequest.started),
+                              Q_ARG(bool, success), Q_ARG(QByteArray, result));
+}
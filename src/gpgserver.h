@@ -0,0 +1,166 @@
+/*
+ *      gpgserver.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __GPGSERVER_H__
+#define __GPGSERVER_H__
+
+#include "gpgcontextpool.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QTime>
+
+/**
+ * @brief A request read from a client of the GpgServer
+ */
+class GpgServerRequest
+{
+public:
+    GpgServerRequest() {
+        connectionId = 0;
+        operation = -1;
+        length = -1;
+        started = 0;
+    }
+
+    int connectionId;
+    QByteArray id; /** chosen by the client, to match the response */
+    int operation;
+    int length; /** of the data, -1 while the header is not read */
+    QStringList uidList; /** ids of the recipients or signers */
+    QByteArray error; /** set, if the request can't be run, e.g. for an unknown key */
+    QByteArray data;
+    int started; /** time the request was read, in ms of the server clock */
+};
+
+/**
+ * @brief Resident crypto service on a local socket, so scripts and other
+ * programs don't start gpg4usb and the gpg engine for every operation.
+ *
+ * @details Clients may send many requests without waiting for the responses.
+ * The requests are processed in parallel by the worker contexts of a
+ * GpgContextPool, so the responses can arrive in another order. A request is
+ * a header line followed by length bytes of data:
+ *
+ *     ID OPERATION LENGTH [KEY ...]\n
+ *
+ * OPERATION is encrypt (for the KEYs), decrypt, sign (clearsign with the KEYs),
+ * verify or stats, KEYs are fingerprints, key ids or email addresses. The
+ * response has the ID of the request, the status OK or ERROR, the length of the
+ * result or error message following the line and the latency in milliseconds,
+ * which includes the time the request waited for a context:
+ *
+ *     ID OK|ERROR LENGTH MILLISECONDS\n
+ *
+ * verify and stats return one line per signature and operation. A malformed
+ * header closes the connection, because the following data can't be framed.
+ */
+class GpgServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Operation {
+        Encrypt,
+        Decrypt,
+        Sign,
+        Verify,
+        Stats
+    };
+
+    /**
+     * @param ctx The context, which holds the keydb and answers passphrase
+     * requests of the worker contexts.
+     * @param parent The parent object.
+     */
+    GpgServer(GpgME::GpgContext *ctx, QObject *parent = 0);
+    ~GpgServer();
+
+    /**
+     * @details Listen on the local socket name, on unix only the user may connect.
+     * A socket left by a crashed server is replaced.
+     */
+    bool listen(const QString &name);
+    QString errorString() const;
+
+    /**
+     * @return Count, failures, mean and maximum latency of each operation
+     */
+    QByteArray statistics() const;
+
+private slots:
+    void slotNewConnection();
+    void slotReadyRead();
+    void slotDisconnected();
+    void slotRequestFinished(int connectionId, QByteArray id, int operation,
+                             int started, bool success, QByteArray result);
+
+private:
+    friend class GpgServerTask;
+    bool readHeader(QLocalSocket *socket, GpgServerRequest *request, QByteArray *error);
+    void runRequest(const GpgServerRequest &request);
+    void sendResponse(QLocalSocket *socket, const QByteArray &id, bool success,
+                      const QByteArray &result, int latency);
+
+    /** latency statistics of an operation */
+    class Metrics
+    {
+    public:
+        Metrics() {
+            count = 0;
+            failed = 0;
+            totalLatency = 0;
+            maxLatency = 0;
+        }
+        int count;
+        int failed;
+        qint64 totalLatency;
+        int maxLatency;
+    };
+
+    GpgME::GpgContext *mCtx;
+    GpgContextPool *mPool;
+    QThreadPool mThreadPool;
+    QLocalServer mServer;
+    QHash<int, QLocalSocket *> mSockets;
+    QHash<QLocalSocket *, GpgServerRequest> mRequests; /** the request being read per socket */
+    int mNextConnectionId;
+    int mPendingCount; /** requests waiting for or running in a worker context */
+    QTime mClock;
+    Metrics mMetrics[Stats];
+};
+
+/**
+ * @brief Processes a request of the GpgServer in a thread of its QThreadPool.
+ */
+class GpgServerTask : public QRunnable
+{
+public:
+    GpgServerTask(GpgServer *server, const GpgServerRequest &request);
+    void run();
+
+private:
+    GpgServer *mServer;
+    GpgServerRequest mRequest;
+};
+
+#endif // __GPGSERVER_H__
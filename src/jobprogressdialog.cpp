@@ -0,0 +1,57 @@
+/*
+ *      jobprogressdialog.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "jobprogressdialog.h"
+
+JobProgressDialog::JobProgressDialog(GpgJob *job, const QString &labelText, QWidget *parent)
+    : QProgressDialog(labelText, tr("Cancel"), 0, 0, parent)
+{
+    mJob = job;
+
+    setWindowTitle(qApp->applicationName());
+    setWindowModality(Qt::WindowModal);
+    // small operations shouldn't flash a dialog
+    setMinimumDuration(500);
+    setAutoClose(false);
+    setAutoReset(false);
+    // starts the timer for minimumDuration, gpg may never report progress
+    setValue(0);
+
+    connect(mJob, SIGNAL(signalProgress(int,int)), this, SLOT(slotProgress(int,int)));
+    connect(mJob, SIGNAL(finished()), this, SLOT(slotJobFinished()));
+    connect(this, SIGNAL(canceled()), mJob, SLOT(slotCancel()));
+}
+
+void JobProgressDialog::slotProgress(int current, int total)
+{
+    // gpg doesn't always know the total, keep the busy indicator then
+    if (total <= 0) {
+        return;
+    }
+    setMaximum(total);
+    setValue(qMin(current, total));
+}
+
+void JobProgressDialog::slotJobFinished()
+{
+    close();
+    deleteLater();
+}
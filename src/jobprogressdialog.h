@@ -0,0 +1,53 @@
+/*
+ *      jobprogressdialog.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __JOBPROGRESSDIALOG_H__
+#define __JOBPROGRESSDIALOG_H__
+
+#include "gpgjob.h"
+#include <QProgressDialog>
+
+/**
+ * @brief Window modal progress dialog for a GpgJob, with a cancel button
+ * which cancels the job. The dialog closes and deletes itself, when the
+ * job is finished.
+ */
+class JobProgressDialog : public QProgressDialog
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param job The job to show the progress for, should not be started yet.
+     * @param labelText The text shown above the progressbar.
+     * @param parent The parent widget.
+     */
+    JobProgressDialog(GpgJob *job, const QString &labelText, QWidget *parent = 0);
+
+private slots:
+    void slotProgress(int current, int total);
+    void slotJobFinished();
+
+private:
+    GpgJob *mJob;
+};
+
+#endif // __JOBPROGRESSDIALOG_H__
@@ -32,6 +32,9 @@ KeyImportDetailDialog::KeyImportDetailDialog(GpgME::GpgContext* ctx, GpgImportIn
         return;
     }
 
+    // the keystore is updated delayed, the imported keys are looked up below
+    mCtx->slotFlushKeyDBChanged();
+
     QVBoxLayout *mvbox = new QVBoxLayout();
 
     this->createGeneralInfoBox();
@@ -26,17 +26,24 @@ KeyList::KeyList(GpgME::GpgContext *ctx, QWidget *parent)
 {
     mCtx = ctx;
 
-    mKeyList = new QTableWidget(this);
-    mKeyList->setColumnCount(6);
+    mModel = new KeyListModel(mCtx, this);
+
+    mKeyList = new QTableView(this);
+    mKeyList->setModel(mModel);
     mKeyList->verticalHeader()->hide();
+    // with a fixed row height, the view only asks the model for the visible rows
+    mKeyList->verticalHeader()->setResizeMode(QHeaderView::Fixed);
+    mKeyList->verticalHeader()->setDefaultSectionSize(fontMetrics().height() + 6);
+    mKeyList->setWordWrap(false);
     mKeyList->setShowGrid(false);
-    mKeyList->setColumnWidth(0, 24);
-    mKeyList->setColumnWidth(1, 20);
-    mKeyList->sortByColumn(2, Qt::AscendingOrder);
+    mKeyList->setColumnWidth(KeyListModel::CheckColumn, 24);
+    mKeyList->setColumnWidth(KeyListModel::TypeColumn, 20);
+    mKeyList->setSortingEnabled(true);
+    mKeyList->sortByColumn(KeyListModel::NameColumn, Qt::AscendingOrder);
     mKeyList->setSelectionBehavior(QAbstractItemView::SelectRows);
     // hide id and fingerprint of key
-    mKeyList->setColumnHidden(4, true);
-    mKeyList->setColumnHidden(5, true);
+    mKeyList->setColumnHidden(KeyListModel::IdColumn, true);
+    mKeyList->setColumnHidden(KeyListModel::FprColumn, true);
 
     // tableitems not editable
     mKeyList->setEditTriggers(QAbstractItemView::NoEditTriggers);
@@ -45,91 +52,44 @@ KeyList::KeyList(GpgME::GpgContext *ctx, QWidget *parent)
     mKeyList->setFocusPolicy(Qt::NoFocus);
 
     mKeyList->setAlternatingRowColors(true);
-
-    QStringList labels;
-    labels << "" << "" << tr("Name") << tr("EMail") << "id" << "fpr";
-    mKeyList->setHorizontalHeaderLabels(labels);
     mKeyList->horizontalHeader()->setStretchLastSection(true);
 
+    mFilterEdit = new QLineEdit(this);
+    mFilterEdit->setToolTip(tr("Show only keys with name, email, id or fingerprint containing the text"));
+    connect(mFilterEdit, SIGNAL(textChanged(QString)), this, SLOT(slotFilterChanged(QString)));
+
+    QHBoxLayout *filterLayout = new QHBoxLayout;
+    filterLayout->addWidget(new QLabel(tr("Search:")));
+    filterLayout->addWidget(mFilterEdit);
+
     QVBoxLayout *layout = new QVBoxLayout;
+    layout->addLayout(filterLayout);
     layout->addWidget(mKeyList);
     layout->setContentsMargins(0, 0, 0, 0);
     layout->setSpacing(3);
     setLayout(layout);
 
     popupMenu = new QMenu(this);
-    connect(mCtx, SIGNAL(signalKeyDBChanged()), this, SLOT(slotRefresh()));
     setAcceptDrops(true);
-    slotRefresh();
 }
 
-void KeyList::slotRefresh()
+void KeyList::slotFilterChanged(const QString &text)
 {
-    QStringList *keyList;
-    keyList = getChecked();
-    // while filling the table, sort enabled causes errors
-    mKeyList->setSortingEnabled(false);
-    mKeyList->clearContents();
-
-    GpgKeyList keys = mCtx->listKeys();
-    mKeyList->setRowCount(keys.size());
-
-    int row = 0;
-    GpgKeyList::iterator it = keys.begin();
-    while (it != keys.end()) {
-
-        QTableWidgetItem *tmp0 = new QTableWidgetItem();
-        tmp0->setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-        tmp0->setCheckState(Qt::Unchecked);
-        mKeyList->setItem(row, 0, tmp0);
-
-        if (it->privkey) {
-            QTableWidgetItem *tmp1 = new QTableWidgetItem(QIcon(":kgpg_key2.png"), "");
-            mKeyList->setItem(row, 1, tmp1);
-        }
-        QTableWidgetItem *tmp2 = new QTableWidgetItem(it->name);
-        tmp2->setToolTip(it->name);
-        mKeyList->setItem(row, 2, tmp2);
-        QTableWidgetItem *tmp3 = new QTableWidgetItem(it->email);
-        tmp3->setToolTip(it->email);
-        // strike out expired keys
-        if(it->expired || it->revoked) {
-            QFont strike = tmp2->font();
-            strike.setStrikeOut(true);
-            tmp2->setFont(strike);
-            tmp3->setFont(strike);
-        }
-        mKeyList->setItem(row, 3, tmp3);
-        QTableWidgetItem *tmp4 = new QTableWidgetItem(it->id);
-        mKeyList->setItem(row, 4, tmp4);
-        QTableWidgetItem *tmp5 = new QTableWidgetItem(it->fpr);
-        mKeyList->setItem(row, 5, tmp5);
-
-
-        it++;
-        ++row;
-    }
-    mKeyList->setSortingEnabled(true);
-    setChecked(keyList);
+    mModel->setFilter(text);
 }
 
 QStringList *KeyList::getChecked()
 {
-    QStringList *ret = new QStringList();
-    for (int i = 0; i < mKeyList->rowCount(); i++) {
-        if (mKeyList->item(i, 0)->checkState() == Qt::Checked) {
-            *ret << mKeyList->item(i, 4)->text();
-        }
-    }
-    return ret;
+    return new QStringList(mModel->checkedIds());
 }
 
 QStringList *KeyList::getAllPrivateKeys()
 {
     QStringList *ret = new QStringList();
-    for (int i = 0; i < mKeyList->rowCount(); i++) {
-        if (mKeyList->item(i, 1)) {
-            *ret << mKeyList->item(i, 4)->text();
+    const GpgKeyStore *store = mCtx->keyStore();
+    for (int i = 0; i < store->size(); i++) {
+        if (store->at(i).privkey) {
+            *ret << store->at(i).id;
         }
     }
     return ret;
@@ -138,9 +98,9 @@ QStringList *KeyList::getAllPrivateKeys()
 QStringList *KeyList::getPrivateChecked()
 {
     QStringList *ret = new QStringList();
-    for (int i = 0; i < mKeyList->rowCount(); i++) {
-        if ((mKeyList->item(i, 0)->checkState() == Qt::Checked) && (mKeyList->item(i, 1))) {
-            *ret << mKeyList->item(i, 4)->text();
+    foreach (QString id, mModel->checkedIds()) {
+        if (mCtx->getKeyById(id).privkey) {
+            *ret << id;
         }
     }
     return ret;
@@ -148,32 +108,25 @@ QStringList *KeyList::getPrivateChecked()
 
 void KeyList::setChecked(QStringList *keyIds)
 {
-    if (!keyIds->isEmpty()) {
-        for (int i = 0; i < mKeyList->rowCount(); i++) {
-            if (keyIds->contains(mKeyList->item(i, 4)->text()))  {
-                mKeyList->item(i, 0)->setCheckState(Qt::Checked);
-            }
-        }
-    }
+    mModel->setChecked(*keyIds);
 }
 
 QStringList *KeyList::getSelected()
 {
     QStringList *ret = new QStringList();
 
-    for (int i = 0; i < mKeyList->rowCount(); i++) {
-        if (mKeyList->item(i, 0)->isSelected() == 1) {
-            *ret << mKeyList->item(i, 4)->text();
-        }
+    foreach (QModelIndex index, mKeyList->selectionModel()->selectedRows()) {
+        *ret << mModel->key(index).id;
     }
     return ret;
 }
 
 bool KeyList::containsPrivateKeys()
 {
-    for (int i = 0; i < mKeyList->rowCount(); i++) {
-        if (mKeyList->item(i, 1)) {
-            return  true;
+    const GpgKeyStore *store = mCtx->keyStore();
+    for (int i = 0; i < store->size(); i++) {
+        if (store->at(i).privkey) {
+            return true;
         }
     }
     return false;
@@ -24,6 +24,7 @@
 
 #include "gpgcontext.h"
 #include "keyimportdetaildialog.h"
+#include "keylistmodel.h"
 #include <QNetworkAccessManager>
 #include <QtNetwork>
 
@@ -31,7 +32,8 @@ QT_BEGIN_NAMESPACE
 class QWidget;
 class QVBoxLayout;
 class QLabel;
-class QTableWidget;
+class QTableView;
+class QLineEdit;
 class QMenu;
 QT_END_NAMESPACE
 
@@ -55,18 +57,20 @@ public:
     bool containsPrivateKeys();
 
 public slots:
-    void slotRefresh();
     void uploadKeyToServer(QByteArray *keys);
 
 private:
     void importKeys(QByteArray inBuffer);
     GpgME::GpgContext *mCtx;
-    QTableWidget *mKeyList;
+    KeyListModel *mModel;
+    QTableView *mKeyList;
+    QLineEdit *mFilterEdit;
     QMenu *popupMenu;
     QNetworkAccessManager *qnam;
 
 private slots:
     void uploadFinished();
+    void slotFilterChanged(const QString &text);
 
 protected:
     void contextMenuEvent(QContextMenuEvent *event);
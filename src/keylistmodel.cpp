@@ -0,0 +1,395 @@
+/*
+ *      keylistmodel.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "keylistmodel.h"
+
+/** Sort predicate on store indexes for qStableSort
+ */
+class KeyListModel::RowLessThan
+{
+public:
+    RowLessThan(const KeyListModel *model) : mModel(model) {}
+    bool operator()(int left, int right) const {
+        return mModel->lessThan(left, right);
+    }
+private:
+    const KeyListModel *mModel;
+};
+
+KeyListModel::KeyListModel(GpgME::GpgContext *ctx, QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    mCtx = ctx;
+    mStore = ctx->keyStore();
+    mSortColumn = NameColumn;
+    mSortOrder = Qt::AscendingOrder;
+    mPrivateKeyIcon = QIcon(":kgpg_key2.png");
+    mStrikeFont.setStrikeOut(true);
+
+    mRemovingRow = false;
+
+    setRows(allKeys(), false);
+
+    connect(mStore, SIGNAL(signalKeyInserted(int)), this, SLOT(slotKeyInserted(int)));
+    connect(mStore, SIGNAL(signalKeyChanged(int)), this, SLOT(slotKeyChanged(int)));
+    connect(mStore, SIGNAL(signalKeyAboutToBeRemoved(int)), this, SLOT(slotKeyAboutToBeRemoved(int)));
+    connect(mStore, SIGNAL(signalKeyRemoved(int)), this, SLOT(slotKeyRemoved(int)));
+    connect(mStore, SIGNAL(signalAboutToBeReset()), this, SLOT(slotAboutToBeReset()));
+    connect(mStore, SIGNAL(signalReset()), this, SLOT(slotReset()));
+}
+
+int KeyListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return mKeyOfRow.size();
+}
+
+int KeyListModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return ColumnCount;
+}
+
+const GpgKey &KeyListModel::key(const QModelIndex &index) const
+{
+    return mStore->at(mKeyOfRow.at(index.row()));
+}
+
+QVariant KeyListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mKeyOfRow.size())
+        return QVariant();
+
+    const GpgKey &key = this->key(index);
+
+    switch (role) {
+    case Qt::CheckStateRole:
+        if (index.column() == CheckColumn)
+            return mCheckedIds.contains(key.id) ? Qt::Checked : Qt::Unchecked;
+        break;
+    case Qt::DecorationRole:
+        if (index.column() == TypeColumn && key.privkey)
+            return mPrivateKeyIcon;
+        break;
+    case Qt::DisplayRole:
+    case Qt::ToolTipRole:
+        switch (index.column()) {
+        case NameColumn:
+            return key.name;
+        case EmailColumn:
+            return key.email;
+        case IdColumn:
+            if (role == Qt::DisplayRole)
+                return key.id;
+            break;
+        case FprColumn:
+            if (role == Qt::DisplayRole)
+                return key.fpr;
+            break;
+        }
+        break;
+    case Qt::FontRole:
+        // strike out expired keys
+        if ((key.expired || key.revoked)
+                && (index.column() == NameColumn || index.column() == EmailColumn)) {
+            return mStrikeFont;
+        }
+        break;
+    }
+
+    return QVariant();
+}
+
+bool KeyListModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || index.column() != CheckColumn || role != Qt::CheckStateRole)
+        return false;
+
+    const GpgKey &key = this->key(index);
+    if (value.toInt() == Qt::Checked) {
+        mCheckedIds.insert(key.id);
+    } else {
+        mCheckedIds.remove(key.id);
+    }
+    emit dataChanged(index, index);
+    return true;
+}
+QVariant KeyListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+        return QVariant();
+
+    switch (section) {
+    case NameColumn:
+        return tr("Name");
+    case EmailColumn:
+        return tr("EMail");
+    case IdColumn:
+        return "id";
+    case FprColumn:
+        return "fpr";
+    default:
+        return QVariant();
+    }
+}
+
+Qt::ItemFlags KeyListModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags flags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    if (index.column() == CheckColumn)
+        flags |= Qt::ItemIsUserCheckable;
+    return flags;
+}
+
+QStringList KeyListModel::checkedIds() const
+{
+    QStringList ret;
+    foreach (const QString &id, mCheckedIds) {
+        if (mStore->findById(id) != NULL) {
+            ret << id;
+        }
+    }
+    return ret;
+}
+
+void KeyListModel::setChecked(const QStringList &keyIds)
+{
+    foreach (const QString &id, keyIds) {
+        mCheckedIds.insert(id);
+    }
+    // keys checked before the store is filled are shown checked once they are inserted
+    if (keyIds.isEmpty() || mKeyOfRow.isEmpty())
+        return;
+    emit dataChanged(index(0, CheckColumn), index(mKeyOfRow.size() - 1, CheckColumn));
+}
+
+void KeyListModel::setFilter(const QString &text)
+{
+    QString filter = text.trimmed();
+    if (filter == mFilter)
+        return;
+
+    beginResetModel();
+    if (filter.isEmpty()) {
+        setRows(allKeys(), false);
+    } else if (KeySearchIndex::isNarrowing(mFilter, filter)) {
+        // only keys shown now can match, and they are sorted already
+        QVector<int> keys;
+        foreach (int keyIndex, mKeyOfRow) {
+            if (KeySearchIndex::matches(mStore->at(keyIndex), filter)) {
+                keys.append(keyIndex);
+            }
+        }
+        setRows(keys, true);
+    } else {
+        setRows(mCtx->keySearchIndex()->search(filter), false);
+    }
+    mFilter = filter;
+    endResetModel();
+}
+
+QString KeyListModel::filter() const
+{
+    return mFilter;
+}
+
+QVector<int> KeyListModel::allKeys() const
+{
+    QVector<int> keys(mStore->size());
+    for (int i = 0; i < keys.size(); i++) {
+        keys[i] = i;
+    }
+    return keys;
+}
+
+void KeyListModel::setRows(const QVector<int> &keys, bool sorted)
+{
+    mKeyOfRow = keys;
+    if (!sorted) {
+        qStableSort(mKeyOfRow.begin(), mKeyOfRow.end(), RowLessThan(this));
+    }
+    mRowOfKey.fill(-1, mStore->size());
+    updateRowsOfKeys(0);
+}
+
+bool KeyListModel::accepts(int keyIndex) const
+{
+    return mFilter.isEmpty() || KeySearchIndex::matches(mStore->at(keyIndex), mFilter);
+}
+
+void KeyListModel::sort(int column, Qt::SortOrder order)
+{
+    mSortColumn = column;
+    mSortOrder = order;
+
+    emit layoutAboutToBeChanged();
+    QModelIndexList oldIndexes = persistentIndexList();
+    QVector<int> oldKeys;
+    foreach (QModelIndex index, oldIndexes) {
+        oldKeys.append(mKeyOfRow.at(index.row()));
+    }
+
+    qStableSort(mKeyOfRow.begin(), mKeyOfRow.end(), RowLessThan(this));
+    updateRowsOfKeys(0);
+
+    for (int i = 0; i < oldIndexes.size(); i++) {
+        changePersistentIndex(oldIndexes.at(i),
+                              index(mRowOfKey.at(oldKeys.at(i)), oldIndexes.at(i).column()));
+    }
+    emit layoutChanged();
+}
+
+/** Compare the keys at the store indexes left and right by the sort column
+ */
+bool KeyListModel::lessThan(int left, int right) const
+{
+    const GpgKey &l = mStore->at(mSortOrder == Qt::AscendingOrder ? left : right);
+    const GpgKey &r = mStore->at(mSortOrder == Qt::AscendingOrder ? right : left);
+
+    switch (mSortColumn) {
+    case CheckColumn:
+        return !mCheckedIds.contains(l.id) && mCheckedIds.contains(r.id);
+    case TypeColumn:
+        return !l.privkey && r.privkey;
+    case NameColumn:
+        return QString::compare(l.name, r.name, Qt::CaseInsensitive) < 0;
+    case EmailColumn:
+        return QString::compare(l.email, r.email, Qt::CaseInsensitive) < 0;
+    case IdColumn:
+        return l.id < r.id;
+    case FprColumn:
+        return l.fpr < r.fpr;
+    }
+    return false;
+}
+
+/** The row, where the key at keyIndex has to be inserted to keep the order
+ */
+int KeyListModel::sortedRow(int keyIndex) const
+{
+    return qUpperBound(mKeyOfRow.begin(), mKeyOfRow.end(), keyIndex, RowLessThan(this))
+           - mKeyOfRow.begin();
+}
+
+void KeyListModel::insertKeyRow(int row, int keyIndex)
+{
+    beginInsertRows(QModelIndex(), row, row);
+    mKeyOfRow.insert(row, keyIndex);
+    updateRowsOfKeys(row);
+    endInsertRows();
+}
+
+void KeyListModel::updateRowsOfKeys(int fromRow)
+{
+    for (int row = fromRow; row < mKeyOfRow.size(); row++) {
+        mRowOfKey[mKeyOfRow.at(row)] = row;
+    }
+}
+
+void KeyListModel::removeKeyRow(int row)
+{
+    beginRemoveRows(QModelIndex(), row, row);
+    mRowOfKey[mKeyOfRow.at(row)] = -1;
+    mKeyOfRow.remove(row);
+    updateRowsOfKeys(row);
+    endRemoveRows();
+}
+
+void KeyListModel::slotKeyInserted(int index)
+{
+    mRowOfKey.append(-1);
+    if (accepts(index)) {
+        insertKeyRow(sortedRow(index), index);
+    }
+}
+
+void KeyListModel::slotKeyChanged(int index)
+{
+    int row = mRowOfKey.at(index);
+
+    // the key may enter or leave the filter
+    if (!accepts(index)) {
+        if (row != -1) {
+            removeKeyRow(row);
+        }
+        return;
+    }
+    if (row == -1) {
+        insertKeyRow(sortedRow(index), index);
+        return;
+    }
+
+    // take the row out, to find the place of the changed key among the others
+    mKeyOfRow.remove(row);
+    int newRow = sortedRow(index);
+    mKeyOfRow.insert(row, index);
+
+    if (newRow == row) {
+        emit dataChanged(this->index(row, 0), this->index(row, ColumnCount - 1));
+        return;
+    }
+
+    removeKeyRow(row);
+    insertKeyRow(newRow, index);
+}
+
+void KeyListModel::slotKeyAboutToBeRemoved(int index)
+{
+    int row = mRowOfKey.at(index);
+    mRemovingRow = (row != -1);
+    if (mRemovingRow) {
+        beginRemoveRows(QModelIndex(), row, row);
+        mKeyOfRow.remove(row);
+        updateRowsOfKeys(row);
+    }
+}
+
+void KeyListModel::slotKeyRemoved(int index)
+{
+    // the store removes its last key only
+    mRowOfKey.remove(index);
+    if (mRemovingRow) {
+        endRemoveRows();
+    }
+}
+
+void KeyListModel::slotAboutToBeReset()
+{
+    beginResetModel();
+}
+
+/** Rebuilt once, instead of inserting many keys row by row. The filter is
+ *  checked key by key, the search index may not be rebuilt yet.
+ */
+void KeyListModel::slotReset()
+{
+    QVector<int> keys;
+    keys.reserve(mStore->size());
+    for (int i = 0; i < mStore->size(); i++) {
+        if (accepts(i)) {
+            keys.append(i);
+        }
+    }
+    setRows(keys, false);
+    endResetModel();
+}
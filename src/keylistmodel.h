@@ -0,0 +1,112 @@
+/*
+ *      keylistmodel.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __KEYLISTMODEL_H__
+#define __KEYLISTMODEL_H__
+
+#include "gpgcontext.h"
+#include <QAbstractTableModel>
+#include <QSet>
+
+/**
+ * @brief Table model over the key store of a GpgContext
+ *
+ * @details The rows follow the signals of the GpgKeyStore, so a change of the
+ * keyring only touches the changed rows. The check state of the keys is kept
+ * in the model by key id.
+ *
+ * Nothing is stored per row except the index of the key in the store, the cells
+ * are created in data() for the rows the view shows. Sorting permutes these
+ * indexes and filtering selects them, so no proxy model is needed.
+ */
+class KeyListModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        CheckColumn = 0,
+        TypeColumn,
+        NameColumn,
+        EmailColumn,
+        IdColumn,
+        FprColumn,
+        ColumnCount
+    };
+
+    KeyListModel(GpgME::GpgContext *ctx, QObject *parent = 0);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    bool setData(const QModelIndex &index, const QVariant &value, int role);
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+    const GpgKey &key(const QModelIndex &index) const;
+
+    /**
+     * @return The ids of the checked keys, which are still in the keyring
+     */
+    QStringList checkedIds() const;
+    void setChecked(const QStringList &keyIds);
+
+    /**
+     * @details Show only keys matching text, see KeySearchIndex.
+     * If text extends the current filter, the shown rows are narrowed down.
+     */
+    void setFilter(const QString &text);
+    QString filter() const;
+
+private slots:
+    void slotKeyInserted(int index);
+    void slotKeyChanged(int index);
+    void slotKeyAboutToBeRemoved(int index);
+    void slotKeyRemoved(int index);
+    void slotAboutToBeReset();
+    void slotReset();
+
+private:
+    class RowLessThan;
+    bool lessThan(int left, int right) const;
+    bool accepts(int keyIndex) const;
+    int sortedRow(int keyIndex) const;
+    QVector<int> allKeys() const;
+    void setRows(const QVector<int> &keys, bool sorted);
+    void insertKeyRow(int row, int keyIndex);
+    void removeKeyRow(int row);
+    void updateRowsOfKeys(int fromRow);
+
+    GpgME::GpgContext *mCtx;
+    const GpgKeyStore *mStore;
+    QVector<int> mKeyOfRow; /** row -> index in the store */
+    QVector<int> mRowOfKey; /** index in the store -> row, -1 if filtered out */
+    QString mFilter;
+    bool mRemovingRow;
+    int mSortColumn;
+    Qt::SortOrder mSortOrder;
+    QSet<QString> mCheckedIds;
+    QIcon mPrivateKeyIcon;
+    QFont mStrikeFont;
+};
+
+#endif // __KEYLISTMODEL_H__
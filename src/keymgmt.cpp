@@ -164,20 +164,34 @@ void KeyMgmt::slotImportKeys(QByteArray inBuffer)
 
 void KeyMgmt::slotImportKeyFromFile()
 {
-    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Key"), "", tr("Key Files") + " (*.asc *.txt);;"+tr("Keyring files")+" (*.gpg);;All Files (*)");
-    if (! fileName.isNull()) {
-        QFile file;
-        file.setFileName(fileName);
-        if (!file.open(QIODevice::ReadOnly)) {
-            qDebug() << tr("Couldn't Open File: ") + fileName;
-            return;
-        }
-        QByteArray inBuffer = file.readAll();
-        slotImportKeys(inBuffer);
-        file.close();
+    QStringList fileNames = QFileDialog::getOpenFileNames(this, tr("Open Key"), "", tr("Key Files") + " (*.asc *.txt);;"+tr("Keyring files")+" (*.gpg);;All Files (*)");
+    if (!fileNames.isEmpty()) {
+        slotImportKeyFiles(fileNames);
     }
 }
 
+GpgJob *KeyMgmt::slotImportKeyFiles(const QStringList &fileNames)
+{
+    GpgJob *job = new GpgJob(mCtx, GpgJob::ImportFiles, this);
+    job->setImportFiles(fileNames);
+    new JobProgressDialog(job, tr("Importing keys..."), this);
+    connect(job, SIGNAL(finished()), this, SLOT(slotImportKeyFilesFinished()));
+    job->start();
+    return job;
+}
+
+void KeyMgmt::slotImportKeyFilesFinished()
+{
+    GpgJob *job = qobject_cast<GpgJob *>(sender());
+    if (!job->errorString().isEmpty()) {
+        QMessageBox::warning(this, tr("File"), job->errorString());
+    }
+    if (!job->isCanceled() || job->importInformation().considered > 0) {
+        new KeyImportDetailDialog(mCtx, job->importInformation(), this);
+    }
+    job->deleteLater();
+}
+
 void KeyMgmt::slotImportKeyFromKeyServer()
 {
     importDialog = new KeyServerImportDialog(mCtx, mKeyList, this);
@@ -28,6 +28,7 @@
 #include "keyimportdetaildialog.h"
 #include "keyserverimportdialog.h"
 #include "keygendialog.h"
+#include "jobprogressdialog.h"
 #include <QtGui>
 
 QT_BEGIN_NAMESPACE
@@ -54,6 +55,13 @@ public slots:
     void slotImportKeyFromClipboard();
     void slotImportKeyFromKeyServer();
     void slotImportKeys(QByteArray inBuffer);
+    /**
+     * @details Import key or keyring files in the background, with a progress
+     * dialog. The keylist is refreshed once, after all files are imported.
+     *
+     * @return The started job, it deletes itself after finished() is emitted.
+     */
+    GpgJob *slotImportKeyFiles(const QStringList &fileNames);
     void slotExportKeyToFile();
     void slotExportKeyToClipboard();
     void slotDeleteSelectedKeys();
@@ -64,6 +72,9 @@ public slots:
 signals:
     void signalStatusBarChanged(QString);
 
+private slots:
+    void slotImportKeyFilesFinished();
+
 private:
     void createMenus();
     void createActions();
@@ -0,0 +1,246 @@
+/*
+ *      keysearchindex.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "keysearchindex.h"
+#include <QSet>
+#include <QStringList>
+#include <algorithm>
+
+KeySearchIndex::KeySearchIndex(const GpgKeyStore *store, QObject *parent)
+    : QObject(parent)
+{
+    mStore = store;
+    mWordsValid = false;
+    addAllKeys();
+
+    connect(mStore, SIGNAL(signalKeyInserted(int)), this, SLOT(slotKeyInserted(int)));
+    connect(mStore, SIGNAL(signalKeyChanged(int)), this, SLOT(slotKeyChanged(int)));
+    connect(mStore, SIGNAL(signalKeyAboutToBeRemoved(int)), this, SLOT(slotKeyAboutToBeRemoved(int)));
+    connect(mStore, SIGNAL(signalReset()), this, SLOT(slotReset()));
+}
+
+QVector<int> KeySearchIndex::search(const QString &query) const
+{
+    QString q = query.toLower();
+    QVector<int> result;
+
+    if (q.isEmpty()) {
+        return result;
+    }
+
+    if (q.length() < 3) {
+        buildWords();
+        QVector<Word>::const_iterator it = qLowerBound(mWords.begin(), mWords.end(), Word(q, -1));
+        for (; it != mWords.end() && it->first.startsWith(q); ++it) {
+            result.append(it->second);
+        }
+        qSort(result);
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    // start with the shortest posting list, and intersect the others with it
+    QList<const QVector<int> *> postings;
+    for (int i = 0; i + 3 <= q.length(); i++) {
+        QHash<quint64, QVector<int> >::const_iterator it = mTrigrams.constFind(trigram(q, i));
+        if (it == mTrigrams.constEnd()) {
+            return result;
+        }
+        postings.append(&it.value());
+    }
+    int shortest = 0;
+    for (int i = 1; i < postings.size(); i++) {
+        if (postings.at(i)->size() < postings.at(shortest)->size()) {
+            shortest = i;
+        }
+    }
+
+    foreach (int index, *postings.at(shortest)) {
+        bool found = true;
+        for (int i = 0; i < postings.size() && found; i++) {
+            found = qBinaryFind(*postings.at(i), index) != postings.at(i)->end();
+        }
+        // all trigrams found, but maybe not in a row
+        if (found && matches(mStore->at(index), q)) {
+            result.append(index);
+        }
+    }
+    return result;
+}
+
+bool KeySearchIndex::matches(const GpgKey &key, const QString &query)
+{
+    QString q = query.toLower();
+    QStringList fields = fieldsOf(key);
+
+    if (q.length() < 3) {
+        foreach (const QString &word, wordsOf(fields)) {
+            if (word.startsWith(q)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    foreach (const QString &field, fields) {
+        if (field.contains(q)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool KeySearchIndex::isNarrowing(const QString &previousQuery, const QString &query)
+{
+    // short queries match words only, so only longer ones can be narrowed down
+    return previousQuery.length() >= 3
+           && query.contains(previousQuery, Qt::CaseInsensitive);
+}
+
+QStringList KeySearchIndex::fieldsOf(const GpgKey &key)
+{
+    QStringList fields;
+    fields << key.name.toLower() << key.email.toLower() << key.id.toLower() << key.fpr.toLower();
+    return fields;
+}
+
+QStringList KeySearchIndex::wordsOf(const QStringList &fields)
+{
+    static const QRegExp separators("[\\s@.<>()\"]+");
+
+    QStringList words;
+    foreach (const QString &field, fields) {
+        words << field.split(separators, QString::SkipEmptyParts);
+    }
+    // search for the short key id too
+    if (fields.at(2).length() > 8) {
+        words << fields.at(2).right(8);
+    }
+    words.removeDuplicates();
+    return words;
+}
+
+QList<quint64> KeySearchIndex::trigramsOf(const QStringList &fields)
+{
+    QSet<quint64> trigrams;
+    foreach (const QString &field, fields) {
+        for (int i = 0; i + 3 <= field.length(); i++) {
+            trigrams.insert(trigram(field, i));
+        }
+    }
+    return trigrams.toList();
+}
+
+quint64 KeySearchIndex::trigram(const QString &text, int pos)
+{
+    return (quint64(text.at(pos).unicode()) << 32)
+           | (quint64(text.at(pos + 1).unicode()) << 16)
+           | quint64(text.at(pos + 2).unicode());
+}
+
+/** Keys are added in the order of their indexes, so every index is
+ *  appended to the posting lists
+ */
+void KeySearchIndex::addAllKeys()
+{
+    mFields.resize(mStore->size());
+    for (int i = 0; i < mStore->size(); i++) {
+        addKey(i);
+    }
+}
+
+void KeySearchIndex::addKey(int index)
+{
+    mFields[index] = fieldsOf(mStore->at(index));
+
+    foreach (quint64 t, trigramsOf(mFields.at(index))) {
+        QVector<int> &posting = mTrigrams[t];
+        posting.insert(qLowerBound(posting.begin(), posting.end(), index), index);
+    }
+
+    mWordsValid = false;
+}
+
+void KeySearchIndex::removeKey(int index)
+{
+    foreach (quint64 t, trigramsOf(mFields.at(index))) {
+        QHash<quint64, QVector<int> >::iterator it = mTrigrams.find(t);
+        if (it == mTrigrams.end()) {
+            continue;
+        }
+        QVector<int>::iterator pos = qBinaryFind(it.value().begin(), it.value().end(), index);
+        if (pos != it.value().end()) {
+            it.value().erase(pos);
+        }
+        if (it.value().isEmpty()) {
+            mTrigrams.erase(it);
+        }
+    }
+
+    mFields[index].clear();
+    mWordsValid = false;
+}
+
+/** Rebuild the word vector, removing single words from the sorted vector
+ *  would cost a scan per removed key
+ */
+void KeySearchIndex::buildWords() const
+{
+    if (mWordsValid) {
+        return;
+    }
+    mWords.clear();
+    for (int i = 0; i < mFields.size(); i++) {
+        foreach (const QString &word, wordsOf(mFields.at(i))) {
+            mWords.append(Word(word, i));
+        }
+    }
+    qSort(mWords);
+    mWordsValid = true;
+}
+
+void KeySearchIndex::slotKeyInserted(int index)
+{
+    mFields.append(QStringList());
+    addKey(index);
+}
+
+void KeySearchIndex::slotKeyChanged(int index)
+{
+    removeKey(index);
+    addKey(index);
+}
+
+void KeySearchIndex::slotKeyAboutToBeRemoved(int index)
+{
+    // the store removes its last key only
+    removeKey(index);
+    mFields.remove(index);
+}
+
+void KeySearchIndex::slotReset()
+{
+    mFields.clear();
+    mTrigrams.clear();
+    mWords.clear();
+    mWordsValid = false;
+    addAllKeys();
+}
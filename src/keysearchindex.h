@@ -0,0 +1,85 @@
+/*
+ *      keysearchindex.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __KEYSEARCHINDEX_H__
+#define __KEYSEARCHINDEX_H__
+
+#include "gpgkeystore.h"
+#include <QPair>
+
+/**
+ * @brief Search index over name, email, key id and fingerprint of the keys in a GpgKeyStore
+ *
+ * @details Queries shorter than three characters match the beginning of a word,
+ * they are looked up in a sorted vector of all words. Longer queries match anywhere,
+ * the candidates are the intersection of the posting lists of the trigrams of the
+ * query. The trigrams follow the signals of the store, the word vector is built
+ * again on the first short query after a change.
+ */
+class KeySearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    KeySearchIndex(const GpgKeyStore *store, QObject *parent = 0);
+
+    /**
+     * @return The sorted store indexes of all keys matching query
+     */
+    QVector<int> search(const QString &query) const;
+
+    /**
+     * @details Check a single key, for narrowing down the result of an earlier search.
+     */
+    static bool matches(const GpgKey &key, const QString &query);
+
+    /**
+     * @details True if every key matching query also matches previousQuery,
+     * so the result of previousQuery can be narrowed down with matches().
+     */
+    static bool isNarrowing(const QString &previousQuery, const QString &query);
+
+private slots:
+    void slotKeyInserted(int index);
+    void slotKeyChanged(int index);
+    void slotKeyAboutToBeRemoved(int index);
+    void slotReset();
+
+private:
+    typedef QPair<QString, int> Word;
+
+    static QStringList fieldsOf(const GpgKey &key);
+    static QStringList wordsOf(const QStringList &fields);
+    static QList<quint64> trigramsOf(const QStringList &fields);
+    static quint64 trigram(const QString &text, int pos);
+    void addAllKeys();
+    void addKey(int index);
+    void removeKey(int index);
+    void buildWords() const;
+
+    const GpgKeyStore *mStore;
+    QVector<QStringList> mFields; /** lower case fields of every key, to remove it again */
+    QHash<quint64, QVector<int> > mTrigrams;
+    mutable QVector<Word> mWords; /** sorted by word, then index */
+    mutable bool mWordsValid; /** false, if mWords has to be rebuilt */
+};
+
+#endif // __KEYSEARCHINDEX_H__
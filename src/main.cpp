@@ -22,13 +22,16 @@
 #include <QApplication>
 #include "mainwindow.h"
 #include "gpgconstants.h"
+#include "batchmode.h"
 
 int main(int argc, char *argv[])
 {
 
     Q_INIT_RESOURCE(gpg4usb);
 
-    QApplication app(argc, argv);
+    // without gui in batch mode, so it also runs without a display
+    bool batch = BatchMode::isRequested(argc, argv);
+    QApplication app(argc, argv, !batch);
 
     // get application path
     QString appPath = qApp->applicationDirPath();
@@ -72,6 +75,12 @@ int main(int argc, char *argv[])
     qDebug() << "gpg4usb non portable build";
 #endif
 
+    if (batch) {
+        QSettings::setDefaultFormat(QSettings::IniFormat);
+        BatchMode batchMode(app.arguments().mid(1));
+        return batchMode.exec();
+    }
+
     /*QLocale ql(lang);
     foreach(QLocale l , QLocale::matchingLocales(ql.language(), ql.script(), ql.country())) {
         qDebug() << "l: " <<  l.bcp47Name();
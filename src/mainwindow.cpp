@@ -275,6 +275,10 @@ void MainWindow::createActions()
     encryptAct->setToolTip(tr("Encrypt Message"));
     connect(encryptAct, SIGNAL(triggered()), this, SLOT(slotEncrypt()));
 
+    encryptAttachmentsAct = new QAction(tr("Encrypt With &Attachments..."), this);
+    encryptAttachmentsAct->setToolTip(tr("Encrypt Message And Files Into One Message"));
+    connect(encryptAttachmentsAct, SIGNAL(triggered()), this, SLOT(slotEncryptAttachments()));
+
     decryptAct = new QAction(tr("&Decrypt"), this);
     decryptAct->setIcon(QIcon(":decrypted.png"));
     decryptAct->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_D));
@@ -288,6 +292,10 @@ void MainWindow::createActions()
     fileEncryptAct->setToolTip(tr("Encrypt File"));
     connect(fileEncryptAct, SIGNAL(triggered()), this, SLOT(slotFileEncrypt()));
 
+    fileBatchEncryptAct = new QAction(tr("Encrypt &Multiple Files"), this);
+    fileBatchEncryptAct->setToolTip(tr("Encrypt Multiple Files"));
+    connect(fileBatchEncryptAct, SIGNAL(triggered()), this, SLOT(slotFileBatchEncrypt()));
+
     fileDecryptAct = new QAction(tr("&Decrypt File"), this);
     fileDecryptAct->setToolTip(tr("Decrypt File"));
     connect(fileDecryptAct, SIGNAL(triggered()), this, SLOT(slotFileDecrypt()));
@@ -300,6 +308,10 @@ void MainWindow::createActions()
     fileVerifyAct->setToolTip(tr("Verify File"));
     connect(fileVerifyAct, SIGNAL(triggered()), this, SLOT(slotFileVerify()));
 
+    fileBatchVerifyAct = new QAction(tr("Verify M&ultiple Files"), this);
+    fileBatchVerifyAct->setToolTip(tr("Verify Multiple Files"));
+    connect(fileBatchVerifyAct, SIGNAL(triggered()), this, SLOT(slotFileBatchVerify()));
+
 
     signAct = new QAction(tr("&Sign"), this);
     signAct->setIcon(QIcon(":signature.png"));
@@ -412,6 +424,7 @@ void MainWindow::slotDisableTabActions(int number)
     verifyAct->setDisabled(disable);
     signAct->setDisabled(disable);
     encryptAct->setDisabled(disable);
+    encryptAttachmentsAct->setDisabled(disable);
     decryptAct->setDisabled(disable);
 
     redoAct->setDisabled(disable);
@@ -461,12 +474,15 @@ void MainWindow::createMenus()
 
     fileEncMenu = new QMenu(tr("&File..."));
     fileEncMenu->addAction(fileEncryptAct);
+    fileEncMenu->addAction(fileBatchEncryptAct);
     fileEncMenu->addAction(fileDecryptAct);
     fileEncMenu->addAction(fileSignAct);
     fileEncMenu->addAction(fileVerifyAct);
+    fileEncMenu->addAction(fileBatchVerifyAct);
 
     cryptMenu = menuBar()->addMenu(tr("&Crypt"));
     cryptMenu->addAction(encryptAct);
+    cryptMenu->addAction(encryptAttachmentsAct);
     cryptMenu->addAction(decryptAct);
     cryptMenu->addSeparator();
     cryptMenu->addAction(signAct);
@@ -691,20 +707,17 @@ void MainWindow::parseMime(QByteArray *message)
     QString pText;
     bool showmadock = false;
 
-    Mime *mime = new Mime(message);
-    foreach(MimePart tmp, mime->parts()) {
-        if (tmp.header.getValue("Content-Type") == "text/plain"
-                && tmp.header.getValue("Content-Transfer-Encoding") != "base64") {
-
-            QByteArray body;
-            if (tmp.header.getValue("Content-Transfer-Encoding") == "quoted-printable") {
-                Mime::quotedPrintableDecode(tmp.body, body);
-            } else {
-                body = tmp.body;
-            }
-            pText.append(QString(body));
+    // the parts share the message, attachments are decoded when saved
+    Mime mime(*message);
+    const QList<MimePart> &parts = mime.parts();
+    for (int i = 0; i < parts.size(); i++) {
+        const MimePart &part = parts.at(i);
+        if (part.header.getValue("Content-Type") == "text/plain"
+                && part.header.getValue("Content-Transfer-Encoding") != "base64") {
+            QTextCodec *codec = QTextCodec::codecForName(part.header.getParam("Content-Type", "charset").toLatin1());
+            pText.append(codec ? codec->toUnicode(part.decodedBody()) : QString(part.decodedBody()));
         } else {
-            (mAttachments->addMimePart(&tmp));
+            mAttachments->addMimePart(part);
             showmadock = true;
         }
     }
@@ -761,10 +774,60 @@ void MainWindow::slotEncrypt()
 
     QStringList *uidList = mKeyList->getChecked();
 
-    QByteArray *tmp = new QByteArray();
-    if (mCtx->encrypt(uidList, edit->curTextPage()->toPlainText().toUtf8(), tmp)) {
-        QString *tmp2 = new QString(*tmp);
-        edit->slotFillTextEditWithText(*tmp2);
+    GpgJob *job = new GpgJob(mCtx, GpgJob::Encrypt, this);
+    job->setKeys(*uidList);
+    job->setInput(edit->curTextPage()->toPlainText().toUtf8());
+    startJob(job, tr("Encrypting..."), SLOT(slotEncryptFinished()));
+}
+
+void MainWindow::slotEncryptFinished()
+{
+    GpgJob *job = qobject_cast<GpgJob *>(sender());
+    EditorPage *page = finishJob(job);
+    if (page != 0 && job->isSuccessful()) {
+        edit->fillTextPage(page, QString(job->output()));
+    }
+}
+
+void MainWindow::slotEncryptAttachments()
+{
+    if (edit->tabCount()==0 || edit->slotCurPage() == 0) {
+        return;
+    }
+
+    QStringList *checked = mKeyList->getChecked();
+    QStringList uidList = *checked;
+    delete checked;
+    if (uidList.isEmpty()) {
+        QMessageBox::critical(this, tr("No Key Selected"), tr("No Key Selected"));
+        return;
+    }
+
+    QStringList fileNames = QFileDialog::getOpenFileNames(this, tr("Attach Files"));
+    if (fileNames.isEmpty()) {
+        return;
+    }
+    QString outFileName = QFileDialog::getSaveFileName(this, tr("Save Encrypted Message"), "",
+                          tr("Encrypted Messages") + " (*.asc);;All Files (*)");
+    if (outFileName.isEmpty()) {
+        return;
+    }
+
+    GpgJob *job = new GpgJob(mCtx, GpgJob::EncryptMime, this);
+    job->setKeys(uidList);
+    job->setInput(edit->curTextPage()->toPlainText().toUtf8());
+    job->setAttachments(fileNames, outFileName);
+    startJob(job, tr("Encrypting..."), SLOT(slotEncryptAttachmentsFinished()));
+}
+
+void MainWindow::slotEncryptAttachmentsFinished()
+{
+    GpgJob *job = qobject_cast<GpgJob *>(sender());
+    finishJob(job);
+    if (job->isSuccessful()) {
+        QMessageBox::information(this, tr("Done"), tr("Output saved to %1").arg(job->outFileName()));
+    } else if (!job->errorString().isEmpty()) {
+        QMessageBox::warning(this, tr("File"), job->errorString());
     }
 }
 
@@ -776,10 +839,18 @@ void MainWindow::slotSign()
 
     QStringList *uidList = mKeyList->getPrivateChecked();
 
-    QByteArray *tmp = new QByteArray();
+    GpgJob *job = new GpgJob(mCtx, GpgJob::Sign, this);
+    job->setKeys(*uidList);
+    job->setInput(edit->curTextPage()->toPlainText().toUtf8());
+    startJob(job, tr("Signing..."), SLOT(slotSignFinished()));
+}
 
-    if (mCtx->sign(uidList, edit->curTextPage()->toPlainText().toUtf8(), tmp)) {
-        edit->slotFillTextEditWithText(QString::fromUtf8(*tmp));
+void MainWindow::slotSignFinished()
+{
+    GpgJob *job = qobject_cast<GpgJob *>(sender());
+    EditorPage *page = finishJob(job);
+    if (page != 0 && job->isSuccessful()) {
+        edit->fillTextPage(page, QString::fromUtf8(job->output()));
     }
 }
 
@@ -789,15 +860,26 @@ void MainWindow::slotDecrypt()
         return;
     }
 
-    QByteArray *decrypted = new QByteArray();
     QByteArray text = edit->curTextPage()->toPlainText().toAscii(); // TODO: toUtf8() here?
     mCtx->preventNoDataErr(&text);
 
-    // try decrypt, if fail do nothing, especially don't replace text
-    if(!mCtx->decrypt(text, decrypted)) {
+    GpgJob *job = new GpgJob(mCtx, GpgJob::Decrypt, this);
+    job->setInput(text);
+    startJob(job, tr("Decrypting..."), SLOT(slotDecryptFinished()));
+}
+
+void MainWindow::slotDecryptFinished()
+{
+    GpgJob *job = qobject_cast<GpgJob *>(sender());
+    EditorPage *page = finishJob(job);
+
+    // if decrypt failed or the tab is closed do nothing, especially don't replace text
+    if (page == 0 || !job->isSuccessful()) {
         return;
     }
 
+    QByteArray *decrypted = new QByteArray(job->output());
+
     /*
          *   1) is it mime (content-type:)
          *   2) parse header
@@ -806,7 +888,7 @@ void MainWindow::slotDecrypt()
     if(Mime::isMime(decrypted)) {
         Header header = Mime::getHeader(decrypted);
         // is it multipart, is multipart-parsing enabled
-        if(header.getValue("Content-Type") == "multipart/mixed"
+        if(header.getValue("Content-Type").toLower().startsWith("multipart/")
            && settings.value("mime/parseMime").toBool()) {
             parseMime(decrypted);
         } else if(header.getValue("Content-Type") == "text/plain"
@@ -819,7 +901,34 @@ void MainWindow::slotDecrypt()
             }
         }
     }
-    edit->slotFillTextEditWithText(QString::fromUtf8(*decrypted));
+    edit->fillTextPage(page, QString::fromUtf8(*decrypted));
+
+    // the signatures are checked while decrypting, so show them right away
+    if (!job->signatures().isEmpty()) {
+        page->closeNoteByClass("verifyNotification");
+        VerifyNotification *vn = new VerifyNotification(this, mCtx, mKeyList, page->getTextPage());
+        if (vn->setDecryptedSignatures(job->signatures(), job->input())) {
+            page->showNotificationWidget(vn, "verifyNotification");
+        } else {
+            vn->close();
+        }
+    }
+}
+
+void MainWindow::startJob(GpgJob *job, const QString &labelText, const char *finishedSlot)
+{
+    // the tab may be changed or closed while the job is running, the result
+    // goes to the tab the input was taken from
+    mJobPages.insert(job, edit->slotCurPage());
+    new JobProgressDialog(job, labelText, this);
+    connect(job, SIGNAL(finished()), this, finishedSlot);
+    job->start();
+}
+
+EditorPage *MainWindow::finishJob(GpgJob *job)
+{
+    job->deleteLater();
+    return mJobPages.take(job);
 }
 
 void MainWindow::slotFind()
@@ -919,6 +1028,13 @@ void MainWindow::slotFileEncrypt()
         new FileEncryptionDialog(mCtx, *keyList, FileEncryptionDialog::Encrypt, this);
 }
 
+void MainWindow::slotFileBatchEncrypt()
+{
+        QStringList *keyList;
+        keyList = mKeyList->getChecked();
+        new BatchEncryptionDialog(mCtx, *keyList, this);
+}
+
 void MainWindow::slotFileDecrypt()
 {
         QStringList *keyList;
@@ -940,6 +1056,11 @@ void MainWindow::slotFileVerify()
         new FileEncryptionDialog(mCtx, *keyList, FileEncryptionDialog::Verify, this);
 }
 
+void MainWindow::slotFileBatchVerify()
+{
+        new BatchVerifyDialog(mCtx, mKeyList, this);
+}
+
 void MainWindow::slotOpenSettingsDialog()
 {
 
@@ -27,11 +27,14 @@
 #include "keymgmt.h"
 #include "textedit.h"
 #include "fileencryptiondialog.h"
+#include "batchencryptiondialog.h"
+#include "batchverifydialog.h"
 #include "settingsdialog.h"
 #include "aboutdialog.h"
 #include "verifynotification.h"
 #include "findwidget.h"
 #include "wizard.h"
+#include "jobprogressdialog.h"
 
 QT_BEGIN_NAMESPACE
 class QMainWindow;
@@ -89,16 +92,42 @@ private slots:
      */
     void slotEncrypt();
 
+    /**
+     * @details Fill the currently active textedit-page with the result of the encrypt job.
+     */
+    void slotEncryptFinished();
+
+    /**
+     * @details Encrypt the text of currently active textedit-page together with
+     * files chosen by the user into one multipart message, which is saved to a file.
+     */
+    void slotEncryptAttachments();
+
+    /**
+     * @details Tell the user, where the message of the encrypt job was saved.
+     */
+    void slotEncryptAttachmentsFinished();
+
     /**
      * @details Show a passphrase dialog and decrypt the text of currently active tab.
      */
     void slotDecrypt();
 
+    /**
+     * @details Fill the currently active textedit-page with the result of the decrypt job.
+     */
+    void slotDecryptFinished();
+
     /**
      * @details Sign the text of currently active tab with the checked private keys
      */
     void slotSign();
 
+    /**
+     * @details Fill the currently active textedit-page with the result of the sign job.
+     */
+    void slotSignFinished();
+
     /**
      * @details Verify the text of currently active tab and show verify information.
      * If document is signed with a key, which is not in keylist, show import missing
@@ -162,6 +191,11 @@ private slots:
      */
     void slotFileEncrypt();
 
+    /**
+     * @details Open dialog for encrypting multiple files.
+     */
+    void slotFileBatchEncrypt();
+
     /**
      * @details Open dialog for decrypting file.
      */
@@ -177,6 +211,11 @@ private slots:
      */
     void slotFileVerify();
 
+    /**
+     * @details Open dialog for verifying multiple files with their signatures.
+     */
+    void slotFileBatchVerify();
+
     /**
      * @details Open settings-dialog.
      */
@@ -289,6 +328,21 @@ private:
      */
     void parseMime(QByteArray *message);
 
+    /**
+     * @details Show a progress dialog for job and start it. The current tab is
+     * remembered, see finishJob().
+     * @param job The job to start
+     * @param labelText The text of the progress dialog
+     * @param finishedSlot Slot of mainwindow, which gets the result of the job
+     */
+    void startJob(GpgJob *job, const QString &labelText, const char *finishedSlot);
+
+    /**
+     * @details Schedule the deletion of the finished job.
+     * @return The tab, which was current when job was started, or 0 if it is closed
+     */
+    EditorPage *finishJob(GpgJob *job);
+
     /**
      * @brief return true, if restart is needed
      */
@@ -325,6 +379,7 @@ private:
     QAction *closeTabAct; /** Action to print */
     QAction *quitAct; /** Action to quit application */
     QAction *encryptAct; /** Action to encrypt text */
+    QAction *encryptAttachmentsAct; /** Action to encrypt text with attached files */
     QAction *decryptAct; /** Action to decrypt text */
     QAction *signAct; /** Action to sign text */
     QAction *verifyAct; /** Action to verify text */
@@ -346,9 +401,11 @@ private:
     QAction *zoomOutAct; /** Action to zoom out */
     QAction *aboutAct; /** Action to open about dialog */
     QAction *fileEncryptAct; /** Action to open dialog for encrypting file */
+    QAction *fileBatchEncryptAct; /** Action to open dialog for encrypting multiple files */
     QAction *fileDecryptAct; /** Action to open dialog for decrypting file */
     QAction *fileSignAct; /** Action to open dialog for signing file */
     QAction *fileVerifyAct; /** Action to open dialog for verifying file */
+    QAction *fileBatchVerifyAct; /** Action to open dialog for verifying multiple files */
     QAction *openSettingsAct; /** Action to open settings dialog */
     QAction *openTranslateAct; /** Action to open translate doc*/
     QAction *openTutorialAct; /** Action to open tutorial */
@@ -369,6 +426,7 @@ private:
     KeyServerImportDialog *importDialog; /**< TODO */
     bool attachmentDockCreated;
     bool restartNeeded;
+    QHash<GpgJob *, QPointer<EditorPage> > mJobPages; /** tab of every running job */
 };
 
 #endif // __GPGWIN_H__
@@ -19,21 +19,14 @@
  *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
  */
 
-/***
- * quotedPrintableDecode copied from KCodecs, where it is stated:
-
-   The quoted-printable codec as described in RFC 2045, section 6.7. is by
-   Rik Hemsley (C) 2001.
-
- */
-
-/*    TODO: proper import / copyright statement
- *
- */
-
 #include "mime.h"
+#include "mimedecoder.h"
+#include <QFileInfo>
+#include <QMap>
+#include <QTextCodec>
+#include <string.h>
 
-Mime::Mime(QByteArray *message)
+Mime::Mime(const QByteArray &message)
 {
     splitParts(message);
     /*
@@ -82,31 +75,329 @@ Mime::~Mime()
 
 }
 
-void Mime::splitParts(QByteArray *message)
+/** Maximum depth of nested multiparts, deeper ones are left as single part */
+static const int maxMultipartDepth = 16;
+
+/**
+ * Boyer-Moore-Horspool search for a boundary delimiter, the skip table is
+ * built once per multipart, so every byte of the body is looked at once at most.
+ */
+class DelimiterSearch
+{
+public:
+    DelimiterSearch(const QByteArray &pattern) {
+        mPattern = pattern;
+        int len = pattern.size();
+        for (int i = 0; i < 256; i++) {
+            mSkip[i] = len;
+        }
+        for (int i = 0; i < len - 1; i++) {
+            mSkip[uchar(pattern.at(i))] = len - 1 - i;
+        }
+    }
+
+    int indexIn(const char *data, int from, int to) const {
+        const char *pattern = mPattern.constData();
+        int last = mPattern.size() - 1;
+        int pos = from;
+        while (pos + last < to) {
+            uchar c = data[pos + last];
+            if (c == uchar(pattern[last]) && memcmp(data + pos, pattern, last) == 0) {
+                return pos;
+            }
+            pos += mSkip[c];
+        }
+        return -1;
+    }
+
+    int size() const {
+        return mPattern.size();
+    }
+
+private:
+    QByteArray mPattern;
+    int mSkip[256];
+};
+
+/**
+ * Find the next delimiter line "--boundary" or "--boundary--" (RFC 2046, 5.1.1)
+ * in data between from and end. It has to start a line and may be followed by
+ * whitespace only. lineEnd is set to the start of the next line, close is set
+ * for the close delimiter.
+ */
+static int findDelimiter(const DelimiterSearch &search, const char *data, int start,
+                         int from, int end, int *lineEnd, bool *close)
+{
+    while (true) {
+        int pos = search.indexIn(data, from, end);
+        if (pos < 0) {
+            return -1;
+        }
+        from = pos + 1;
+        if (pos > start && data[pos - 1] != '\n') {
+            continue;
+        }
+
+        int p = pos + search.size();
+        *close = (p + 1 < end && data[p] == '-' && data[p + 1] == '-');
+        if (*close) {
+            p += 2;
+        }
+        while (p < end && (data[p] == ' ' || data[p] == '\t')) {
+            p++;
+        }
+        if (p < end && data[p] == '\r') {
+            p++;
+        }
+        if (p == end || data[p] == '\n') {
+            *lineEnd = qMin(p + 1, end);
+            return pos;
+        }
+    }
+}
+
+/**
+ * Find the empty line, which ends the header starting at start. Returns the end
+ * of the header, bodyStart is set to the line after the empty line.
+ */
+static int findHeaderEnd(const char *data, int start, int end, int *bodyStart)
+{
+    int i = start;
+    // a part without header starts with the empty line
+    if (i < end && data[i] == '\n') {
+        *bodyStart = i + 1;
+        return i;
+    }
+    if (i + 1 < end && data[i] == '\r' && data[i + 1] == '\n') {
+        *bodyStart = i + 2;
+        return i;
+    }
+    for (; i < end; i++) {
+        if (data[i] != '\n') {
+            continue;
+        }
+        if (i + 1 < end && data[i + 1] == '\n') {
+            *bodyStart = i + 2;
+            return i;
+        }
+        if (i + 2 < end && data[i + 1] == '\r' && data[i + 2] == '\n') {
+            *bodyStart = i + 3;
+            return i;
+        }
+    }
+    *bodyStart = end;
+    return end;
+}
+
+/** Split the message into the part tree, the parts only keep the offsets of
+ *  their bodies in the message, which is shared, not copied.
+ */
+void Mime::splitParts(const QByteArray &message)
+{
+    mMessage = message;
+    mRoot = MimePart();
+    mRoot.message = mMessage;
+    mPartList.clear();
+
+    parsePart(&mRoot, 0, mMessage.size(), 0);
+    collectParts(mRoot);
+}
+
+void Mime::parsePart(MimePart *part, int start, int end, int depth)
 {
-    int pos1, pos2, headEnd;
-    MimePart p_tmp;
+    const char *data = mMessage.constData();
+    int bodyStart;
+    int headEnd = findHeaderEnd(data, start, end, &bodyStart);
+
+    QByteArray header(data + start, headEnd - start);
+    part->header = parseHeader(&header);
+    part->message = mMessage;
+    part->bodyStart = bodyStart;
+    part->bodyLength = end - bodyStart;
+
+    if (depth < maxMultipartDepth
+            && part->header.getValue("Content-Type").toLower().startsWith("multipart/")) {
+        QByteArray boundary = part->header.getParam("Content-Type", "boundary").toUtf8();
+        if (!boundary.isEmpty()) {
+            splitMultipart(part, boundary, depth + 1);
+        }
+    }
+}
 
-    // find the boundary
-    pos1 = message->indexOf("boundary=\"") + 10 ;
-    pos2 = message->indexOf("\"\n", pos1);
-    QByteArray boundary = message->mid(pos1, pos2 - pos1);
-    //qDebug() << "boundary: " << boundary;
+/** Every delimiter is searched once in the body of the multipart, and the
+ *  nested parts only in their own range, so parsing is linear in the size
+ *  of the message for every level of nesting.
+ */
+void Mime::splitMultipart(MimePart *part, const QByteArray &boundary, int depth)
+{
+    const char *data = mMessage.constData();
+    int start = part->bodyStart;
+    int end = start + part->bodyLength;
+    DelimiterSearch search("--" + boundary);
+
+    int lineEnd;
+    bool close;
+    // the preamble before the first delimiter is ignored
+    int pos = findDelimiter(search, data, start, start, end, &lineEnd, &close);
+    while (pos >= 0 && !close) {
+        int partStart = lineEnd;
+        int nextLineEnd;
+        bool nextClose = false;
+        int next = findDelimiter(search, data, start, partStart, end, &nextLineEnd, &nextClose);
+
+        // the line break before the delimiter belongs to the delimiter
+        int partEnd = (next < 0) ? end : next;
+        if (partEnd > partStart && data[partEnd - 1] == '\n') {
+            partEnd--;
+            if (partEnd > partStart && data[partEnd - 1] == '\r') {
+                partEnd--;
+            }
+        }
 
-    while (pos2 > pos1) {
+        MimePart child;
+        parsePart(&child, partStart, partEnd, depth);
+        part->children.append(child);
 
-        pos1 = message->indexOf(boundary, pos2) + boundary.length() + 1 ;
-        headEnd = message->indexOf("\n\n", pos1);
-        if (headEnd < 0)
-            break;
-        QByteArray header = message->mid(pos1 , headEnd - pos1);
+        pos = next;
+        lineEnd = nextLineEnd;
+        close = nextClose;
+    }
+}
 
-        p_tmp.header = parseHeader(&header);
+void Mime::collectParts(const MimePart &part)
+{
+    if (part.children.isEmpty()) {
+        mPartList.append(part);
+        return;
+    }
 
-        pos2 = message->indexOf(boundary, headEnd);
-        p_tmp.body = message->mid(headEnd , pos2 - headEnd);
+    if (part.header.getValue("Content-Type").toLower() == "multipart/alternative") {
+        // the alternatives are ordered by preference, the last is the best one,
+        // but text/plain is what the editor can show
+        const MimePart *preferred = &part.children.last();
+        foreach (const MimePart &child, part.children) {
+            if (child.header.getValue("Content-Type").toLower() == "text/plain") {
+                preferred = &child;
+                break;
+            }
+        }
+        collectParts(*preferred);
+        return;
+    }
 
-        mPartList.append(p_tmp);
+    foreach (const MimePart &child, part.children) {
+        collectParts(child);
+    }
+}
+
+static int skipSpace(const char *data, int i, int size)
+{
+    while (i < size && (data[i] == ' ' || data[i] == '\t')) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Parse the value and the parameters of a structured field (RFC 2045, 5.1):
+ * quoted strings may contain ; and =, and RFC 2231 parameters may be split
+ * into numbered sections (name*0, name*1) and be encoded (name*=utf-8''%E2%82%AC).
+ */
+static void parseParams(const QByteArray &line, int from, QString *value, QHash<QString, QString> *params)
+{
+    const char *data = line.constData();
+    int size = line.size();
+
+    int i = from;
+    while (i < size && data[i] != ';') {
+        i++;
+    }
+    *value = QString::fromUtf8(data + from, i - from).trimmed();
+
+    // sections of the RFC 2231 parameters, with their number and whether they are encoded
+    QHash<QByteArray, QMap<int, QPair<QByteArray, bool> > > sections;
+
+    while (i < size) {
+        // skip the ;
+        i = skipSpace(data, i + 1, size);
+        int nameStart = i;
+        while (i < size && data[i] != '=' && data[i] != ';') {
+            i++;
+        }
+        QByteArray name = QByteArray(data + nameStart, i - nameStart).trimmed().toLower();
+        if (i == size || data[i] == ';') {
+            continue;
+        }
+
+        i = skipSpace(data, i + 1, size);
+        QByteArray paramValue;
+        if (i < size && data[i] == '"') {
+            // quoted string, \ quotes the next character
+            for (i++; i < size && data[i] != '"'; i++) {
+                if (data[i] == '\\' && i + 1 < size) {
+                    i++;
+                }
+                paramValue.append(data[i]);
+            }
+            while (i < size && data[i] != ';') {
+                i++;
+            }
+        } else {
+            int valueStart = i;
+            while (i < size && data[i] != ';') {
+                i++;
+            }
+            paramValue = QByteArray(data + valueStart, i - valueStart).trimmed();
+        }
+        if (name.isEmpty()) {
+            continue;
+        }
+
+        bool encoded = name.endsWith('*');
+        if (encoded) {
+            name.chop(1);
+        }
+        int section = 0;
+        int star = name.indexOf('*');
+        if (star >= 0) {
+            bool ok;
+            section = name.mid(star + 1).toInt(&ok);
+            if (!ok) {
+                continue;
+            }
+            name.truncate(star);
+        } else if (!encoded) {
+            params->insert(QString::fromLatin1(name), QString::fromUtf8(paramValue));
+            continue;
+        }
+        sections[name].insert(section, qMakePair(paramValue, encoded));
+    }
+
+    // join the sections, they override a parameter of the same name without *
+    QHashIterator<QByteArray, QMap<int, QPair<QByteArray, bool> > > it(sections);
+    while (it.hasNext()) {
+        it.next();
+        QByteArray bytes;
+        QByteArray charset;
+        int expected = 0;
+        QMap<int, QPair<QByteArray, bool> >::const_iterator s;
+        for (s = it.value().constBegin(); s != it.value().constEnd() && s.key() == expected; ++s, expected++) {
+            QByteArray section = s.value().first;
+            if (s.value().second) {
+                // the first encoded section starts with charset'language'
+                int quote1 = (s.key() == 0) ? section.indexOf('\'') : -1;
+                int quote2 = (quote1 < 0) ? -1 : section.indexOf('\'', quote1 + 1);
+                if (quote2 >= 0) {
+                    charset = section.left(quote1);
+                    section = section.mid(quote2 + 1);
+                }
+                section = QByteArray::fromPercentEncoding(section);
+            }
+            bytes.append(section);
+        }
+        QTextCodec *codec = charset.isEmpty() ? 0 : QTextCodec::codecForName(charset);
+        params->insert(QString::fromLatin1(it.key()),
+                       codec != 0 ? codec->toUnicode(bytes) : QString::fromUtf8(bytes));
     }
 }
 
@@ -115,29 +406,29 @@ Header Mime::parseHeader(QByteArray *header)
 
     QList<HeadElem> ret;
 
+    header->replace("\r\n", "\n");
+
     /** http://www.aspnetmime.com/help/welcome/overviewmimeii.html :
      * If a line starts with any white space, that line is said to be 'folded' and is actually
      * part of the header above it.
      */
     header->replace("\n ", " ");
+    header->replace("\n\t", " ");
 
     //split header at newlines
     foreach(QByteArray line , header->split(* "\n")) {
+        //split lines at the first :, the value may contain more
+        int colon = line.indexOf(':');
+        if (colon < 0) {
+            continue;
+        }
         HeadElem elem;
-        //split lines at :
-        QList<QByteArray> tmp2 = line.split(* ":");
-        elem.name = tmp2[0].trimmed();
-        if (tmp2[1].contains(';')) {
-            // split lines at ;
-            // TODO: what if ; is inside ""
-            QList<QByteArray> tmp3 = tmp2[1].split(* ";");
-            elem.value = QString(tmp3.takeFirst().trimmed());
-            foreach(QByteArray tmp4, tmp3) {
-                QList<QByteArray> tmp5 = tmp4.split(* "=");
-                elem.params.insert(QString(tmp5[0].trimmed()), QString(tmp5[1].trimmed()));
-            }
+        elem.name = QString::fromLatin1(line.constData(), colon).trimmed();
+        // only the Content- fields have parameters, e.g. a subject may contain ;
+        if (elem.name.startsWith("Content-", Qt::CaseInsensitive)) {
+            parseParams(line, colon + 1, &elem.value, &elem.params);
         } else {
-            elem.value = tmp2[1].trimmed();
+            elem.value = QString::fromUtf8(line.constData() + colon + 1).trimmed();
         }
         ret.append(elem);
     }
@@ -145,8 +436,9 @@ Header Mime::parseHeader(QByteArray *header)
 }
 
 Header Mime::getHeader(const QByteArray *message) {
-    int headEnd = message->indexOf("\n\n");
-    QByteArray header = message->mid(0, headEnd);
+    int bodyStart;
+    int headEnd = findHeaderEnd(message->constData(), 0, message->size(), &bodyStart);
+    QByteArray header = message->left(headEnd);
     return parseHeader(&header);
 }
 
@@ -164,80 +456,92 @@ bool Mime::isMime(const QByteArray *message)
     return message->startsWith("Content-Type:");
 }
 
-/***
- * quotedPrintableDecode copied from KCodecs, where it is stated:
-
-   The quoted-printable codec as described in RFC 2045, section 6.7. is by
-   Rik Hemsley (C) 2001.
-
+/** The quoted-printable codec as described in RFC 2045, section 6.7.
  */
+void Mime::quotedPrintableDecode(const QByteArray& in, QByteArray& out)
+{
+    out = MimeDecoder::decode(MimeDecoder::QuotedPrintable, in);
+}
 
-static const char hexChars[16] = {
-    '0', '1', '2', '3', '4', '5', '6', '7',
-    '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
-};
+uint qHash(const HeaderName &key)
+{
+    // header names are ascii, folding the ascii letters is enough
+    const QChar *p = key.name().unicode();
+    int size = key.name().size();
+    uint h = 0;
+    for (int i = 0; i < size; i++) {
+        ushort c = p[i].unicode();
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        h = 31 * h + c;
+    }
+    return h;
+}
 
-/******************************** KCodecs ********************************/
-// strchr(3) for broken systems.
-static int rikFindChar(register const char * _s, const char c)
+void Header::setHeader(const QList<HeadElem> &heads)
 {
-    register const char * s = _s;
+    headElems = heads;
+    mIndex.clear();
+    mIndex.reserve(headElems.size());
+    // backwards, so the first field of a name is indexed
+    for (int i = headElems.size() - 1; i >= 0; i--) {
+        mIndex.insert(HeaderName(headElems.at(i).name), i);
+    }
+}
 
-    while (true) {
-        if ((0 == *s) || (c == *s)) break; ++s;
-        if ((0 == *s) || (c == *s)) break; ++s;
-        if ((0 == *s) || (c == *s)) break; ++s;
-        if ((0 == *s) || (c == *s)) break; ++s;
+const HeadElem *Header::find(const QString &key) const
+{
+    QHash<HeaderName, int>::const_iterator it = mIndex.constFind(HeaderName(key));
+    if (it == mIndex.constEnd()) {
+        return 0;
     }
+    return &headElems.at(it.value());
+}
 
-    return s - _s;
+QString Header::getValue(const QString &key) const
+{
+    const HeadElem *elem = find(key);
+    return (elem != 0) ? elem->value : QString();
 }
 
-void Mime::quotedPrintableDecode(const QByteArray& in, QByteArray& out)
+QHash<QString, QString> Header::getParams(const QString &key) const
 {
-    // clear out the output buffer
-    out.resize(0);
-    if (in.isEmpty())
-        return;
+    const HeadElem *elem = find(key);
+    return (elem != 0) ? elem->params : QHash<QString, QString>();
+}
 
-    char *cursor;
-    const char *data;
-    const unsigned int length = in.size();
-
-    data = in.data();
-    out.resize(length);
-    cursor = out.data();
-
-    for (unsigned int i = 0; i < length; i++) {
-        char c(in[i]);
-
-        if ('=' == c) {
-            if (i < length - 2) {
-                char c1 = in[i + 1];
-                char c2 = in[i + 2];
-
-                if (('\n' == c1) || ('\r' == c1 && '\n' == c2)) {
-                    // Soft line break. No output.
-                    if ('\r' == c1)
-                        i += 2;        // CRLF line breaks
-                    else
-                        i += 1;
-                } else {
-                    // =XX encoded byte.
-
-                    int hexChar0 = rikFindChar(hexChars, c1);
-                    int hexChar1 = rikFindChar(hexChars, c2);
-
-                    if (hexChar0 < 16 && hexChar1 < 16) {
-                        *cursor++ = char((hexChar0 * 16) | hexChar1);
-                        i += 2;
-                    }
-                }
-            }
-        } else {
-            *cursor++ = c;
-        }
-    }
+QString Header::getParam(const QString &key, const QString &pKey) const
+{
+    const HeadElem *elem = find(key);
+    // parameter names are case insensitive, toLower() doesn't copy lowercase ones
+    return (elem != 0) ? elem->params.value(pKey.toLower()) : QString();
+}
+
+QByteArray MimePart::body() const
+{
+    return message.mid(bodyStart, bodyLength);
+}
 
-    out.truncate(cursor - out.data());
+QByteArray MimePart::decodedBody() const
+{
+    // no copy, only a view of the body for decoding
+    QByteArray raw = QByteArray::fromRawData(message.constData() + bodyStart, bodyLength);
+    return MimeDecoder::decode(MimeDecoder::encodingFor(header.getValue("Content-Transfer-Encoding")), raw);
+}
+
+bool MimePart::decodeToDevice(QIODevice *device) const
+{
+    MimeDecoder decoder(MimeDecoder::encodingFor(header.getValue("Content-Transfer-Encoding")));
+    return decoder.decodeToDevice(message.constData() + bodyStart, bodyLength, device);
+}
+
+QString MimePart::fileName() const
+{
+    QString name = header.getParam("Content-Type", "name");
+    if (name.isEmpty()) {
+        name = header.getParam("Content-Disposition", "filename");
+    }
+    // the sender must not choose the directory, e.g. with ../
+    return QFileInfo(name).fileName();
 }
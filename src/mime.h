@@ -24,6 +24,9 @@
 
 #include <QHashIterator>
 #include <QHash>
+#include <QByteArray>
+#include <QString>
+#include <QIODevice>
 
 QT_BEGIN_NAMESPACE
 class QByteArray;
@@ -36,7 +39,7 @@ class HeadElem
 public:
     QString name;
     QString value;
-    QHash<QString, QString> params;
+    QHash<QString, QString> params; /** unquoted and decoded, with lowercase names */
 
     /*    QDataStream & operator<<(QDataStream& Stream, const HeadElem& H)
         {
@@ -45,59 +48,104 @@ public:
 
 };
 
-class Header
+/**
+ * @brief Name of a header field, which is compared case insensitive (RFC 2822)
+ */
+class HeaderName
 {
 public:
-    QList<HeadElem> headElems;
-
-    Header() {}
+    HeaderName(const QString &name) : mName(name) {}
 
-    Header(QList <HeadElem> heads) {
-        headElems = heads;
+    bool operator==(const HeaderName &other) const {
+        return mName.compare(other.mName, Qt::CaseInsensitive) == 0;
     }
 
-    void setHeader(QList <HeadElem> heads) {
-       headElems = heads;
+    const QString &name() const {
+        return mName;
     }
 
-    QString getValue(QString key) {
-        foreach(HeadElem tmp, headElems) {
-            //qDebug() << "gv: " << tmp.name << ":" << tmp.value;
-            if (tmp.name == key)
-                return tmp.value;
-        }
-        return "";
-    }
+private:
+    QString mName;
+};
 
-    QHash<QString, QString> getParams(QString key) {
-        foreach(HeadElem tmp, headElems) {
-            //qDebug() << "gv: " << tmp.name << ":" << tmp.value;
-            if (tmp.name == key)
-                //return tmp.value;
-                return tmp.params;
-        }
-        return *(new QHash<QString, QString>());
-    }
+uint qHash(const HeaderName &key);
+
+/**
+ * @brief The fields of a header, with an index of the field names, so a field
+ * is found in constant time without copying it.
+ */
+class Header
+{
+public:
+    Header() {}
 
-    QString getParam(QString key, QString pKey) {
-        foreach(HeadElem tmp, headElems) {
-            //qDebug() << "gv: " << tmp.name << ":" << tmp.value;
-            if (tmp.name == key)
-                return tmp.params.value(pKey);
-        }
-        return "";
+    Header(const QList<HeadElem> &heads) {
+        setHeader(heads);
     }
 
+    void setHeader(const QList<HeadElem> &heads);
 
+    /**
+     * @return The first field named key (case insensitive), or 0
+     */
+    const HeadElem *find(const QString &key) const;
+
+    QString getValue(const QString &key) const;
+    QHash<QString, QString> getParams(const QString &key) const;
+    QString getParam(const QString &key, const QString &pKey) const;
+
+    const QList<HeadElem> &elems() const {
+        return headElems;
+    }
+
+private:
+    QList<HeadElem> headElems;
+    QHash<HeaderName, int> mIndex; /** index of the first field with a name in headElems */
 };
 
+/**
+ * @brief A part of a multipart message. The body is not copied, but referenced
+ * by its offset in the message, which is shared by all parts of the message.
+ *
+ * The parts of a multipart are its children, so nested multiparts form a tree.
+ */
 class MimePart
 {
 public:
-    Header header;
-    QByteArray body;
-
+    MimePart() {
+        bodyStart = 0;
+        bodyLength = 0;
+    }
 
+    Header header;
+    QByteArray message; /** the whole message, implicitly shared */
+    int bodyStart; /** offset of the body in message */
+    int bodyLength;
+    QList<MimePart> children; /** the parts, if this is a multipart */
+
+    /**
+     * @return The body as in the message, without decoding
+     */
+    QByteArray body() const;
+
+    /**
+     * @details Decode the body as given by the Content-Transfer-Encoding,
+     * only this copies the body out of the message.
+     */
+    QByteArray decodedBody() const;
+
+    /**
+     * @details Decode the body chunk by chunk into device, e.g. to save an
+     * attachment without holding it in memory.
+     *
+     * @return false, if writing to device failed
+     */
+    bool decodeToDevice(QIODevice *device) const;
+
+    /**
+     * @return The file name of an attachment, without any directory
+     */
+    QString fileName() const;
 
     /*    QDataStream & operator<<(QDataStream& Stream, const Part& P)
         {
@@ -112,21 +160,35 @@ class Mime
 {
 
 public:
-    Mime(QByteArray *message); // Constructor
+    Mime(const QByteArray &message); // Constructor
     ~Mime(); // Destructor
     static bool isMultipart(QByteArray *message);
     static bool isMime(const QByteArray *message);
-    QList<MimePart> parts() {
+    /**
+     * @details The parts to show, in order: the leaves of the part tree, of a
+     * multipart/alternative only the text/plain alternative (or the last one).
+     */
+    const QList<MimePart> &parts() const {
         return mPartList;
     }
-    void splitParts(QByteArray *message);
+    /**
+     * @details The whole message as part tree.
+     */
+    const MimePart &root() const {
+        return mRoot;
+    }
+    void splitParts(const QByteArray &message);
     static Header getHeader(const QByteArray *message);
     static Header parseHeader(QByteArray *header);
     static void quotedPrintableDecode(const QByteArray& in, QByteArray& out);
 
 private:
-    QByteArray *mMessage;
-    QByteArray *mBoundary;
+    void parsePart(MimePart *part, int start, int end, int depth);
+    void splitMultipart(MimePart *part, const QByteArray &boundary, int depth);
+    void collectParts(const MimePart &part);
+
+    QByteArray mMessage; /** shared with the parts */
+    MimePart mRoot;
     QList<MimePart> mPartList;
 
 };
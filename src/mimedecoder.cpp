@@ -0,0 +1,264 @@
+/*
+ *      mimedecoder.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "mimedecoder.h"
+#include <string.h>
+
+/** value of the base64 characters, -1 for line breaks, padding and invalid ones */
+static const signed char base64Values[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/** value of the hex digits of quoted-printable escapes, -1 for other characters */
+static const signed char hexValues[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/** chunk size for decodeToDevice() */
+static const int chunkSize = 64 * 1024;
+
+MimeDecoder::MimeDecoder(Encoding encoding)
+{
+    mEncoding = encoding;
+    mBits = 0;
+    mBitCount = 0;
+}
+
+MimeDecoder::Encoding MimeDecoder::encodingFor(const QString &contentTransferEncoding)
+{
+    QString encoding = contentTransferEncoding.trimmed().toLower();
+    if (encoding == "base64") {
+        return Base64;
+    }
+    if (encoding == "quoted-printable") {
+        return QuotedPrintable;
+    }
+    return Identity;
+}
+
+QByteArray MimeDecoder::decode(Encoding encoding, const QByteArray &in)
+{
+    MimeDecoder decoder(encoding);
+    QByteArray out;
+    decoder.decode(in.constData(), in.size(), &out);
+    decoder.finish(&out);
+    return out;
+}
+
+void MimeDecoder::decode(const char *in, int size, QByteArray *out)
+{
+    int offset = out->size();
+    out->resize(offset + maxDecodedSize(size));
+    int written = decodeChunk(in, size, out->data() + offset);
+    out->resize(offset + written);
+}
+
+void MimeDecoder::finish(QByteArray *out)
+{
+    // the = of an incomplete escape at the end of the input is dropped,
+    // a soft line break at the end is dropped as a whole
+    QByteArray rest = mPending.mid(1);
+    if (!rest.isEmpty() && rest != "\r" && rest != "\n") {
+        out->append(rest);
+    }
+    mPending.clear();
+    mBits = 0;
+    mBitCount = 0;
+}
+
+bool MimeDecoder::decodeToDevice(const char *in, qint64 size, QIODevice *device)
+{
+    QByteArray buffer(maxDecodedSize(chunkSize), 0);
+
+    for (qint64 pos = 0; pos < size; pos += chunkSize) {
+        int len = int(qMin(size - pos, qint64(chunkSize)));
+        int written = decodeChunk(in + pos, len, buffer.data());
+        if (device->write(buffer.constData(), written) != written) {
+            return false;
+        }
+    }
+
+    QByteArray rest;
+    finish(&rest);
+    return device->write(rest) == rest.size();
+}
+
+/** base64 needs 3 bytes for 4 characters (plus the bits of an incomplete
+ *  quantum), quoted-printable at most the input and a pending escape.
+ */
+int MimeDecoder::maxDecodedSize(int size) const
+{
+    if (mEncoding == Base64) {
+        return size / 4 * 3 + 3;
+    }
+    return size + 2;
+}
+
+int MimeDecoder::decodeChunk(const char *in, int size, char *out)
+{
+    switch (mEncoding) {
+    case Base64:
+        return decodeBase64(in, size, out);
+    case QuotedPrintable:
+    {
+        char *cursor = out;
+        // complete an escape split between the chunks with the first bytes
+        while (!mPending.isEmpty() && size > 0) {
+            int take = qMin(size, 3);
+            QByteArray escape = mPending + QByteArray(in, take);
+            mPending.clear();
+            in += take;
+            size -= take;
+            cursor += decodeQuotedPrintable(escape.constData(), escape.size(), cursor);
+        }
+        cursor += decodeQuotedPrintable(in, size, cursor);
+        return cursor - out;
+    }
+    default:
+        memcpy(out, in, size);
+        return size;
+    }
+}
+
+int MimeDecoder::decodeBase64(const char *in, int size, char *out)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(in);
+    const uchar *end = p + size;
+    char *cursor = out;
+    quint32 bits = mBits;
+    int bitCount = mBitCount;
+
+    while (p < end) {
+        // a quantum of four characters without line breaks in between is
+        // decoded at once, which are all but the ones at the line ends
+        if (bitCount == 0) {
+            while (end - p >= 4) {
+                int a = base64Values[p[0]];
+                int b = base64Values[p[1]];
+                int c = base64Values[p[2]];
+                int d = base64Values[p[3]];
+                if ((a | b | c | d) < 0) {
+                    break;
+                }
+                quint32 quantum = (a << 18) | (b << 12) | (c << 6) | d;
+                cursor[0] = char(quantum >> 16);
+                cursor[1] = char(quantum >> 8);
+                cursor[2] = char(quantum);
+                cursor += 3;
+                p += 4;
+            }
+            if (p == end) {
+                break;
+            }
+        }
+
+        int value = base64Values[*p++];
+        if (value < 0) {
+            continue;
+        }
+        bits = (bits << 6) | value;
+        bitCount += 6;
+        if (bitCount >= 8) {
+            bitCount -= 8;
+            *cursor++ = char(bits >> bitCount);
+            bits &= (1 << bitCount) - 1;
+        }
+    }
+
+    mBits = bits;
+    mBitCount = bitCount;
+    return cursor - out;
+}
+
+int MimeDecoder::decodeQuotedPrintable(const char *in, int size, char *out)
+{
+    const char *p = in;
+    const char *end = in + size;
+    char *cursor = out;
+
+    while (p < end) {
+        // copy everything up to the next escape at once
+        const char *escape = static_cast<const char *>(memchr(p, '=', end - p));
+        const char *runEnd = (escape != 0) ? escape : end;
+        memcpy(cursor, p, runEnd - p);
+        cursor += runEnd - p;
+        p = runEnd;
+        if (p == end) {
+            break;
+        }
+
+        if (end - p < 3) {
+            // the escape may continue in the next chunk
+            mPending = QByteArray(p, end - p);
+            break;
+        }
+
+        char c1 = p[1];
+        char c2 = p[2];
+        if (c1 == '\n') {
+            // soft line break, no output
+            p += 2;
+        } else if (c1 == '\r' && c2 == '\n') {
+            p += 3;
+        } else {
+            int high = hexValues[uchar(c1)];
+            int low = hexValues[uchar(c2)];
+            if ((high | low) >= 0) {
+                *cursor++ = char((high << 4) | low);
+                p += 3;
+            } else {
+                // not an escape, drop the =
+                p += 1;
+            }
+        }
+    }
+    return cursor - out;
+}
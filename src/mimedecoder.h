@@ -0,0 +1,90 @@
+/*
+ *      mimedecoder.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __MIMEDECODER_H__
+#define __MIMEDECODER_H__
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+/**
+ * @brief Table driven decoder for the Content-Transfer-Encodings base64 and
+ * quoted-printable (RFC 2045), which decodes the input chunk by chunk.
+ *
+ * @details The state between the chunks is kept by the decoder, so an
+ * attachment can be decoded into a file without holding it in memory:
+ *
+ *     MimeDecoder decoder(MimeDecoder::Base64);
+ *     decoder.decodeToDevice(data, size, &file);
+ */
+class MimeDecoder
+{
+public:
+    enum Encoding {
+        Identity, /** 7bit, 8bit and binary are copied */
+        Base64,
+        QuotedPrintable
+    };
+
+    explicit MimeDecoder(Encoding encoding);
+
+    /**
+     * @return The encoding for the value of a Content-Transfer-Encoding header
+     */
+    static Encoding encodingFor(const QString &contentTransferEncoding);
+
+    /**
+     * @details Decode in as a whole.
+     */
+    static QByteArray decode(Encoding encoding, const QByteArray &in);
+
+    /**
+     * @details Decode the next chunk of the input and append it to out.
+     */
+    void decode(const char *in, int size, QByteArray *out);
+
+    /**
+     * @details Append what is left from the last chunk to out, e.g. an
+     * incomplete escape at the end of the input, and reset the decoder.
+     */
+    void finish(QByteArray *out);
+
+    /**
+     * @details Decode in in chunks and write it to device.
+     *
+     * @return false, if writing to device failed
+     */
+    bool decodeToDevice(const char *in, qint64 size, QIODevice *device);
+
+private:
+    int maxDecodedSize(int size) const;
+    int decodeChunk(const char *in, int size, char *out);
+    int decodeBase64(const char *in, int size, char *out);
+    int decodeQuotedPrintable(const char *in, int size, char *out);
+
+    Encoding mEncoding;
+    quint32 mBits; /** base64: the bits of an incomplete quantum */
+    int mBitCount;
+    QByteArray mPending; /** quoted-printable: an escape split between chunks */
+};
+
+#endif // __MIMEDECODER_H__
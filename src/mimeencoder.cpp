@@ -0,0 +1,302 @@
+/*
+ *      mimeencoder.cpp
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "mimeencoder.h"
+#include <QFileInfo>
+#include <QUrl>
+#include <QUuid>
+#include <string.h>
+
+/** 57 bytes are encoded to a line of 76 characters */
+static const int lineBytes = 57;
+static const int chunkSize = lineBytes * 1024;
+
+static const char base64Table[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/** The content type for some common suffixes, the receiver needs it
+ *  only to choose an icon or application for the attachment.
+ */
+static QByteArray contentTypeFor(const QString &fileName)
+{
+    static const char *const types[][2] = {
+        { "txt", "text/plain" },
+        { "html", "text/html" },
+        { "htm", "text/html" },
+        { "pdf", "application/pdf" },
+        { "zip", "application/zip" },
+        { "odt", "application/vnd.oasis.opendocument.text" },
+        { "doc", "application/msword" },
+        { "png", "image/png" },
+        { "jpg", "image/jpeg" },
+        { "jpeg", "image/jpeg" },
+        { "gif", "image/gif" },
+        { "mp3", "audio/mpeg" },
+        { "ogg", "audio/ogg" }
+    };
+
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    for (unsigned int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (suffix == QLatin1String(types[i][0])) {
+            return types[i][1];
+        }
+    }
+    return "application/octet-stream";
+}
+
+MimeEncoder::MimeEncoder(const QByteArray &text, const QStringList &fileNames, QObject *parent)
+    : QIODevice(parent)
+{
+    mText = text;
+    mFileNames = fileNames;
+    mBufferPos = 0;
+    mNextFile = 0;
+    mFirstLine = true;
+    mFinished = false;
+    mError = false;
+}
+
+bool MimeEncoder::open(OpenMode mode)
+{
+    if ((mode & ReadWrite) != ReadOnly) {
+        setErrorString(tr("The message can only be read."));
+        return false;
+    }
+
+    // check all files now, and not when half of the message is encrypted
+    foreach (QString fileName, mFileNames) {
+        QFileInfo info(fileName);
+        if (!info.isFile() || !info.isReadable()) {
+            setErrorString(tr("Cannot read file %1.").arg(fileName));
+            return false;
+        }
+    }
+
+    // the boundary must not occur in the parts: base64 never contains "=_",
+    // and the random uuid won't be part of the text
+    QByteArray uuid = QUuid::createUuid().toString().toLatin1();
+    uuid.replace('-', "").replace('{', "").replace('}', "");
+    mBoundary = "=_gpg4usb_" + uuid;
+
+    mBuffer = "Content-Type: multipart/mixed; " + formatParam("boundary", mBoundary) + "\n"
+              "MIME-Version: 1.0\n"
+              "\n"
+              "This is a multi-part message in MIME format.\n"
+              "--" + mBoundary + "\n"
+              "Content-Type: text/plain; charset=utf-8\n"
+              "Content-Transfer-Encoding: 8bit\n"
+              "\n" + mText;
+    mBufferPos = 0;
+    mNextFile = 0;
+    mFinished = false;
+    mError = false;
+
+    // the data is buffered in mBuffer already
+    return QIODevice::open(mode | Unbuffered);
+}
+
+void MimeEncoder::close()
+{
+    mFile.close();
+    mBuffer.clear();
+    mBufferPos = 0;
+    QIODevice::close();
+}
+
+bool MimeEncoder::isSequential() const
+{
+    return true;
+}
+
+bool MimeEncoder::atEnd() const
+{
+    return mFinished && mBufferPos >= mBuffer.size();
+}
+
+qint64 MimeEncoder::bytesAvailable() const
+{
+    return mBuffer.size() - mBufferPos + QIODevice::bytesAvailable();
+}
+
+bool MimeEncoder::hasError() const
+{
+    return mError;
+}
+
+qint64 MimeEncoder::readData(char *data, qint64 maxSize)
+{
+    qint64 read = 0;
+    while (read < maxSize) {
+        if (mBufferPos >= mBuffer.size()) {
+            if (!fillBuffer()) {
+                break;
+            }
+            continue;
+        }
+        qint64 len = qMin(maxSize - read, qint64(mBuffer.size() - mBufferPos));
+        memcpy(data + read, mBuffer.constData() + mBufferPos, len);
+        mBufferPos += len;
+        read += len;
+    }
+    if (mError && read == 0) {
+        return -1;
+    }
+    return read;
+}
+
+qint64 MimeEncoder::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+/** Put the next piece of the message into mBuffer, at most a chunk
+ *  of a file, so the memory usage doesn't depend on the file size.
+ *  Returns false at the end of the message or on errors.
+ */
+bool MimeEncoder::fillBuffer()
+{
+    if (mError) {
+        return false;
+    }
+    mBuffer.clear();
+    mBufferPos = 0;
+
+    if (mFile.isOpen()) {
+        QByteArray chunk(chunkSize, 0);
+        qint64 len = 0;
+        // only the last chunk may end within a line
+        while (len < chunkSize) {
+            qint64 n = mFile.read(chunk.data() + len, chunkSize - len);
+            if (n < 0) {
+                setErrorString(tr("Cannot read file %1:\n%2.").arg(mFile.fileName()).arg(mFile.errorString()));
+                mError = true;
+                mFile.close();
+                return false;
+            }
+            if (n == 0) {
+                break;
+            }
+            len += n;
+        }
+        if (len > 0) {
+            chunk.truncate(len);
+            encodeBase64(chunk, &mBuffer, mFirstLine);
+            mFirstLine = false;
+            return true;
+        }
+        mFile.close();
+    }
+
+    if (mNextFile < mFileNames.size()) {
+        mFile.setFileName(mFileNames.at(mNextFile++));
+        if (!mFile.open(QIODevice::ReadOnly)) {
+            setErrorString(tr("Cannot read file %1:\n%2.").arg(mFile.fileName()).arg(mFile.errorString()));
+            mError = true;
+            return false;
+        }
+        mBuffer = partHeader(mFile.fileName());
+        mFirstLine = true;
+        return true;
+    }
+
+    if (!mFinished) {
+        mBuffer = "\n--" + mBoundary + "--\n";
+        mFinished = true;
+        return true;
+    }
+    return false;
+}
+
+/** The line break before the delimiter belongs to the delimiter,
+ *  so the previous part doesn't end with an additional empty line.
+ */
+QByteArray MimeEncoder::partHeader(const QString &fileName) const
+{
+    QString name = QFileInfo(fileName).fileName();
+    return "\n--" + mBoundary + "\n"
+           "Content-Type: " + contentTypeFor(name) + "; " + formatParam("name", name) + "\n"
+           "Content-Transfer-Encoding: base64\n"
+           "Content-Disposition: attachment; " + formatParam("filename", name) + "\n"
+           "\n";
+}
+
+void MimeEncoder::encodeBase64(const QByteArray &in, QByteArray *out, bool firstLine)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(in.constData());
+    int size = in.size();
+    int lines = (size + lineBytes - 1) / lineBytes;
+
+    int oldSize = out->size();
+    out->resize(oldSize + (size + 2) / 3 * 4 + lines);
+    char *o = out->data() + oldSize;
+
+    while (size > 0) {
+        if (!firstLine) {
+            *o++ = '\n';
+        }
+        firstLine = false;
+
+        int lineSize = qMin(size, lineBytes);
+        int full = lineSize - lineSize % 3;
+        for (int i = 0; i < full; i += 3) {
+            quint32 v = quint32(p[i]) << 16 | quint32(p[i + 1]) << 8 | p[i + 2];
+            o[0] = base64Table[v >> 18];
+            o[1] = base64Table[(v >> 12) & 63];
+            o[2] = base64Table[(v >> 6) & 63];
+            o[3] = base64Table[v & 63];
+            o += 4;
+        }
+        int rest = lineSize - full;
+        if (rest > 0) {
+            quint32 v = quint32(p[full]) << 16;
+            if (rest == 2) {
+                v |= quint32(p[full + 1]) << 8;
+            }
+            o[0] = base64Table[v >> 18];
+            o[1] = base64Table[(v >> 12) & 63];
+            o[2] = rest == 2 ? base64Table[(v >> 6) & 63] : '=';
+            o[3] = '=';
+            o += 4;
+        }
+        p += lineSize;
+        size -= lineSize;
+    }
+    out->truncate(o - out->constData());
+}
+
+QByteArray MimeEncoder::formatParam(const QByteArray &name, const QString &value)
+{
+    bool printable = true;
+    for (int i = 0; i < value.size() && printable; i++) {
+        ushort c = value.at(i).unicode();
+        printable = c >= 0x20 && c < 0x7f;
+    }
+
+    if (!printable) {
+        return name + "*=utf-8''" + QUrl::toPercentEncoding(value);
+    }
+
+    QByteArray quoted = value.toLatin1();
+    quoted.replace('\\', "\\\\").replace('"', "\\\"");
+    return name + "=\"" + quoted + "\"";
+}
@@ -0,0 +1,101 @@
+/*
+ *      mimeencoder.h
+ *
+ *      Copyright 2008 gpg4usb-team <gpg4usb@cpunk.de>
+ *
+ *      This file is part of gpg4usb.
+ *
+ *      Gpg4usb is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      Gpg4usb is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with gpg4usb.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __MIMEENCODER_H__
+#define __MIMEENCODER_H__
+
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <QStringList>
+
+/**
+ * @brief Sequential device, which reads as a multipart/mixed message (RFC 2046)
+ * of a text and a list of files.
+ *
+ * @details The message is produced while it is read, the files are base64
+ * encoded chunk by chunk, so the message can be passed to gpgme as
+ * GpgData without holding the attachments or the encoded message in memory:
+ *
+ *     MimeEncoder message(text, fileNames);
+ *     message.open(QIODevice::ReadOnly);
+ *     ctx->encryptDevice(&uidList, &message, &outFile);
+ */
+class MimeEncoder : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param text The utf-8 encoded text of the first part.
+     * @param fileNames The files to attach, in this order.
+     * @param parent The parent object.
+     */
+    MimeEncoder(const QByteArray &text, const QStringList &fileNames, QObject *parent = 0);
+
+    /**
+     * @details Only ReadOnly is supported, fails if one of the files isn't readable.
+     */
+    bool open(OpenMode mode);
+    void close();
+    bool isSequential() const;
+    bool atEnd() const;
+    qint64 bytesAvailable() const;
+
+    /**
+     * @return true, if reading an attachment failed, errorString() tells which
+     */
+    bool hasError() const;
+
+    /**
+     * @details Encode in as base64 lines of 76 characters and append it to out,
+     * a line break is put before every line, except the first one, if firstLine is set.
+     * in has to be a multiple of 57 bytes, except for the last chunk of a file.
+     */
+    static void encodeBase64(const QByteArray &in, QByteArray *out, bool firstLine);
+
+    /**
+     * @details Format a header parameter, quoted if value is printable ASCII,
+     * otherwise encoded as utf-8 as described in RFC 2231.
+     */
+    static QByteArray formatParam(const QByteArray &name, const QString &value);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize);
+
+private:
+    bool fillBuffer();
+    QByteArray partHeader(const QString &fileName) const;
+
+    QByteArray mText;
+    QStringList mFileNames;
+    QByteArray mBoundary;
+    QByteArray mBuffer; /** the next piece of the message */
+    int mBufferPos;
+    int mNextFile; /** index of the next file to attach */
+    QFile mFile; /** the file, which is currently encoded */
+    bool mFirstLine;
+    bool mFinished;
+    bool mError;
+};
+
+#endif // __MIMEENCODER_H__
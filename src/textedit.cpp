@@ -364,10 +364,14 @@ void TextEdit::slotQuote()
 }
 
 void TextEdit::slotFillTextEditWithText(QString text) {
-    QTextCursor cursor(curTextPage()->document());
+    fillTextPage(slotCurPage(), text);
+}
+
+void TextEdit::fillTextPage(EditorPage *page, const QString &text) {
+    QTextCursor cursor(page->getTextPage()->document());
     cursor.beginEditBlock();
-    this->curTextPage()->selectAll();
-    this->curTextPage()->insertPlainText(text);
+    page->getTextPage()->selectAll();
+    page->getTextPage()->insertPlainText(text);
     cursor.endEditBlock();
 }
 
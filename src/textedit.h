@@ -108,6 +108,12 @@ public slots:
       */
     void slotFillTextEditWithText(QString text);
 
+    /**
+      * @details replace the text of page with given text, e.g. with the result
+      * of a job, which was started while page was current.
+      */
+    void fillTextPage(EditorPage *page, const QString &text);
+
     /**
      * @details Saves the content of the current tab, if it has a filepath
      * otherwise it calls saveAs for the current tab
@@ -29,10 +29,46 @@ VerifyDetailsDialog::VerifyDetailsDialog(QWidget *parent, GpgME::GpgContext* ctx
     //mTextpage = edit;
     mInputData = inputData;
     mInputSignature = inputSignature;
+    mDetached = (inputSignature != 0);
 
+    setupDialog();
+}
+
+VerifyDetailsDialog::VerifyDetailsDialog(QWidget *parent, GpgME::GpgContext* ctx, KeyList* keyList, const GpgSignatureList &signatures, const QByteArray &cipherText) :
+    QDialog(parent)
+{
+    mCtx = ctx;
+    mKeyList = keyList;
+    mInputData = 0;
+    mInputSignature = 0;
+    mSignatures = signatures;
+    mDetached = false;
+    mCipherText = cipherText;
+
+    setupDialog();
+}
+
+VerifyDetailsDialog::VerifyDetailsDialog(QWidget *parent, GpgME::GpgContext* ctx, KeyList* keyList, const GpgSignatureList &signatures,
+                                         const QString &fileName, const QString &sigFileName) :
+    QDialog(parent)
+{
+    mCtx = ctx;
+    mKeyList = keyList;
+    mInputData = 0;
+    mInputSignature = 0;
+    mSignatures = signatures;
+    mDetached = true;
+    mFileName = fileName;
+    mSigFileName = sigFileName;
+
+    setupDialog();
+}
+
+void VerifyDetailsDialog::setupDialog()
+{
     this->setWindowTitle(tr("Signaturedetails"));
 
-    connect(mCtx, SIGNAL(keyDBChanged()), this, SLOT(slotRefresh()));
+    connect(mCtx, SIGNAL(signalKeyDBChanged(QStringList)), this, SLOT(slotRefresh()));
     mainLayout = new QHBoxLayout();
     this->setLayout(mainLayout);
 
@@ -43,6 +79,48 @@ VerifyDetailsDialog::VerifyDetailsDialog(QWidget *parent, GpgME::GpgContext* ctx
 }
 
 void VerifyDetailsDialog::slotRefresh()
+{
+    // Get signature information of current text
+    //QByteArray text = mTextpage->toPlainText().toUtf8();
+    //mCtx->preventNoDataErr(&text);
+    if(mInputSignature != 0) {
+        mSignatures = mCtx->verify(mInputData, mInputSignature);
+    } else if (mInputData != 0) {
+        mSignatures = mCtx->verify(mInputData);
+    } else if (mCtx->signerKeysAdded(mSignatures)) {
+        // a missing key was imported, the signatures can be checked now, in the
+        // background like the first time, the message or file may be large
+        GpgJob *job = 0;
+        if (!mCipherText.isEmpty()) {
+            job = new GpgJob(mCtx, GpgJob::Decrypt, this);
+            job->setInput(mCipherText);
+            new JobProgressDialog(job, tr("Decrypting..."), this);
+        } else if (!mFileName.isEmpty()) {
+            job = new GpgJob(mCtx, GpgJob::VerifyFile, this);
+            job->setSignedFiles(mFileName, mSigFileName);
+            new JobProgressDialog(job, tr("Verifying file..."), this);
+        }
+        if (job != 0) {
+            connect(job, SIGNAL(finished()), this, SLOT(slotVerifyJobFinished()));
+            job->start();
+            return;
+        }
+    }
+
+    showSignatures();
+}
+
+void VerifyDetailsDialog::slotVerifyJobFinished()
+{
+    GpgJob *job = qobject_cast<GpgJob *>(sender());
+    job->deleteLater();
+    if (job->isSuccessful()) {
+        mSignatures = job->signatures();
+    }
+    showSignatures();
+}
+
+void VerifyDetailsDialog::showSignatures()
 {
     mVbox->close();
 
@@ -54,33 +132,23 @@ void VerifyDetailsDialog::slotRefresh()
     buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
     connect(buttonBox, SIGNAL(rejected()), this, SLOT(close()));
 
-    // Get signature information of current text
-    //QByteArray text = mTextpage->toPlainText().toUtf8();
-    //mCtx->preventNoDataErr(&text);
-    gpgme_signature_t sign;
-    if(mInputSignature != 0) {
-        sign = mCtx->verify(mInputData, mInputSignature);
-    } else {
-        sign = mCtx->verify(mInputData);
-    }
-
-    if(sign==0) {
+    if(mSignatures.isEmpty()) {
        mVboxLayout->addWidget(new QLabel(tr("No valid input found")));
        mVboxLayout->addWidget(buttonBox);
        return;
     }
 
     // Get timestamp of signature of current text
-    QDateTime timestamp;
-    timestamp.setTime_t(sign->timestamp);
+    QDateTime timestamp = mSignatures.first().timestamp;
 
     // Set the title widget depending on sign status
-    if(gpg_err_code(sign->status) == GPG_ERR_BAD_SIGNATURE) {
+    if(gpg_err_code(mSignatures.first().status) == GPG_ERR_BAD_SIGNATURE) {
         mVboxLayout->addWidget(new QLabel(tr("Error Validating signature")));
-    } else if (mInputSignature != 0) {
+    } else if (mDetached) {
         mVboxLayout->addWidget(new QLabel(tr("File was signed on <br/> %1 by:<br/>").arg(timestamp.toString(Qt::SystemLocaleLongDate))));
     } else {
-        switch (mCtx->textIsSigned(*mInputData))
+        // without input data, the signatures are from a decrypted text, which is signed completely
+        switch (mInputData != 0 ? mCtx->textIsSigned(*mInputData) : 2)
         {
             case 2:
             {
@@ -93,9 +161,8 @@ void VerifyDetailsDialog::slotRefresh()
         }
     }
     // Add informationbox for every single key
-    while (sign) {
+    foreach (const GpgSignature &sign, mSignatures) {
         VerifyKeyDetailBox *sbox = new VerifyKeyDetailBox(this,mCtx,mKeyList,sign);
-        sign = sign->next;
         mVboxLayout->addWidget(sbox);
     }
 
@@ -24,6 +24,7 @@
 
 #include "editorpage.h"
 #include "verifykeydetailbox.h"
+#include "jobprogressdialog.h"
 #include <QDialog>
 
 class VerifyDetailsDialog : public QDialog
@@ -31,17 +32,37 @@ class VerifyDetailsDialog : public QDialog
     Q_OBJECT
 public:
     explicit VerifyDetailsDialog(QWidget *parent, GpgME::GpgContext* ctx, KeyList* mKeyList, QByteArray* inputData, QByteArray* inputSignature = 0);
+    /**
+     * @details Show signatures found while decrypting cipherText. When a missing
+     * key is imported, cipherText is decrypted again in the background to check them.
+     */
+    explicit VerifyDetailsDialog(QWidget *parent, GpgME::GpgContext* ctx, KeyList* mKeyList, const GpgSignatureList &signatures, const QByteArray &cipherText);
+    /**
+     * @details Show the detached signatures in sigFileName of the file fileName.
+     * When a missing key is imported, the file is verified again in the background.
+     */
+    explicit VerifyDetailsDialog(QWidget *parent, GpgME::GpgContext* ctx, KeyList* mKeyList, const GpgSignatureList &signatures,
+                                 const QString &fileName, const QString &sigFileName);
 
 private slots:
     void slotRefresh();
+    void slotVerifyJobFinished();
 
 private:
+    void setupDialog();
+    void showSignatures();
+
     GpgME::GpgContext *mCtx;
     KeyList *mKeyList;
     QHBoxLayout *mainLayout;
     QWidget *mVbox;
     QByteArray* mInputData; /** Data to be verified */
     QByteArray* mInputSignature; /** Data to be verified */
+    GpgSignatureList mSignatures; /** Signatures shown, if there is no input data */
+    bool mDetached; /** The signatures are detached signatures of a file */
+    QByteArray mCipherText; /** Decrypted text, the signatures were found in */
+    QString mFileName; /** Signed file of detached signatures */
+    QString mSigFileName;
     QDialogButtonBox* buttonBox;
 };
 
@@ -21,34 +21,34 @@
 
 #include "verifykeydetailbox.h"
 
-VerifyKeyDetailBox::VerifyKeyDetailBox(QWidget *parent, GpgME::GpgContext* ctx, KeyList* keyList, gpgme_signature_t signature) :
+VerifyKeyDetailBox::VerifyKeyDetailBox(QWidget *parent, GpgME::GpgContext* ctx, KeyList* keyList, const GpgSignature &signature) :
     QGroupBox(parent)
 {
     this->mCtx = ctx;
     this->mKeyList = keyList;
-    this->fpr=signature->fpr;
+    this->fpr=signature.fpr;
 
     QGridLayout *grid = new QGridLayout();
 
-    switch (gpg_err_code(signature->status))
+    switch (gpg_err_code(signature.status))
     {
         case GPG_ERR_NO_PUBKEY:
         {
             QPushButton *importButton = new QPushButton(tr("Import from keyserver"));
             connect(importButton, SIGNAL(clicked()), this, SLOT(slotImportFormKeyserver()));
 
-            this->setTitle(tr("Key not present with id 0x") + signature->fpr);
+            this->setTitle(tr("Key not present with id 0x") + signature.fpr);
 
             grid->addWidget(new QLabel(tr("Status:")), 0, 0);
             //grid->addWidget(new QLabel(tr("Fingerprint:")), 1, 0);
             grid->addWidget(new QLabel(tr("Key not present in keylist")), 0, 1);
-            //grid->addWidget(new QLabel(signature->fpr), 1, 1);
+            //grid->addWidget(new QLabel(signature.fpr), 1, 1);
             grid->addWidget(importButton, 2,0,2,1);
             break;
         }
         case GPG_ERR_NO_ERROR:
         {
-            GpgKey key = mCtx->getKeyByFpr(signature->fpr);
+            GpgKey key = mCtx->getKeyByFpr(signature.fpr);
 
             this->setTitle(key.name);
             grid->addWidget(new QLabel(tr("Name:")), 0, 0);
@@ -58,14 +58,14 @@ VerifyKeyDetailBox::VerifyKeyDetailBox(QWidget *parent, GpgME::GpgContext* ctx,
 
             grid->addWidget(new QLabel(key.name), 0, 1);
             grid->addWidget(new QLabel(key.email), 1, 1);
-            grid->addWidget(new QLabel(beautifyFingerprint(signature->fpr)), 2, 1);
+            grid->addWidget(new QLabel(beautifyFingerprint(signature.fpr)), 2, 1);
             grid->addWidget(new QLabel(tr("OK")), 3, 1);
 
             break;
         }
         default:
         {
-            GpgKey key = mCtx->getKeyById(signature->fpr);
+            GpgKey key = mCtx->getKeyById(signature.fpr);
             this->setTitle(tr("Error for key with id 0x") + fpr);
             grid->addWidget(new QLabel(tr("Name:")), 0, 0);
             grid->addWidget(new QLabel(tr("EMail:")), 1, 0);
@@ -74,7 +74,7 @@ VerifyKeyDetailBox::VerifyKeyDetailBox(QWidget *parent, GpgME::GpgContext* ctx,
 
             grid->addWidget(new QLabel(key.name), 0, 1);
             grid->addWidget(new QLabel(key.email), 1, 1);
-            grid->addWidget(new QLabel(gpg_strerror(signature->status)), 2, 1);
+            grid->addWidget(new QLabel(gpg_strerror(signature.status)), 2, 1);
             grid->addWidget(new QLabel(beautifyFingerprint(key.fpr)), 3, 1);
 
             break;
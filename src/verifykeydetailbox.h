@@ -31,7 +31,7 @@ class VerifyKeyDetailBox: public QGroupBox
 {
     Q_OBJECT
 public:
-    explicit VerifyKeyDetailBox(QWidget *parent, GpgME::GpgContext* ctx, KeyList* mKeyList,  gpgme_signature_t signature);
+    explicit VerifyKeyDetailBox(QWidget *parent, GpgME::GpgContext* ctx, KeyList* mKeyList,  const GpgSignature &signature);
 
 private slots:
     void slotImportFormKeyserver();
@@ -29,7 +29,7 @@ VerifyNotification::VerifyNotification(QWidget *parent, GpgME::GpgContext *ctx,
     mTextpage = edit;
     verifyLabel = new QLabel(this);
 
-    connect(mCtx, SIGNAL(keyDBChanged()), this, SLOT(slotRefresh()));
+    connect(mCtx, SIGNAL(signalKeyDBChanged(QStringList)), this, SLOT(slotRefresh()));
     connect(edit, SIGNAL(textChanged()), this, SLOT(close()));
 
     importFromKeyserverAct = new QAction(tr("Import missing key from Keyserver"), this);
@@ -44,6 +44,8 @@ VerifyNotification::VerifyNotification(QWidget *parent, GpgME::GpgContext *ctx,
     importFromKeyserverAct->setVisible(false);
 
     keysNotInList = new QStringList();
+    mDecrypted = false;
+    mDecryptJob = 0;
     detailsButton = new QPushButton(tr("Details"),this);
     detailsButton->setMenu(detailMenu);
     QHBoxLayout *notificationWidgetLayout = new QHBoxLayout(this);
@@ -87,43 +89,84 @@ void VerifyNotification::showImportAction(bool visible)
 
 void VerifyNotification::slotShowVerifyDetails()
 {
+    if (mDecrypted) {
+        new VerifyDetailsDialog(this, mCtx, mKeyList, mSignatures, mCipherText);
+        return;
+    }
     QByteArray text = mTextpage->toPlainText().toUtf8();
     mCtx->preventNoDataErr(&text);
     new VerifyDetailsDialog(this, mCtx, mKeyList, &text);
 }
 
+bool VerifyNotification::setDecryptedSignatures(const GpgSignatureList &signatures, const QByteArray &cipherText)
+{
+    mDecrypted = true;
+    mSignatures = signatures;
+    mCipherText = cipherText;
+    // the signature covered the whole encrypted text
+    return showSignatures(2);
+}
+
 bool VerifyNotification::slotRefresh()
 {
-    verify_label_status verifyStatus=VERIFY_ERROR_OK;
+    // the text in the page is already decrypted, the signatures can only be
+    // checked again by decrypting again, which is needed for imported keys only.
+    // The message may be large, so it is decrypted in the background.
+    if (mDecrypted) {
+        if (mDecryptJob == 0 && mCtx->signerKeysAdded(mSignatures)) {
+            mDecryptJob = new GpgJob(mCtx, GpgJob::Decrypt, this);
+            mDecryptJob->setInput(mCipherText);
+            connect(mDecryptJob, SIGNAL(finished()), this, SLOT(slotDecryptFinished()));
+            mDecryptJob->start();
+        }
+        return showSignatures(2);
+    }
 
     QByteArray text = mTextpage->toPlainText().toUtf8();
     mCtx->preventNoDataErr(&text);
     int textIsSigned = mCtx->textIsSigned(text);
 
-    gpgme_signature_t sign = mCtx->verify(&text);
+    mSignatures = mCtx->verify(&text);
+    return showSignatures(textIsSigned);
+}
+
+void VerifyNotification::slotDecryptFinished()
+{
+    mDecryptJob->deleteLater();
+    if (mDecryptJob->isSuccessful()) {
+        mSignatures = mDecryptJob->signatures();
+        showSignatures(2);
+    }
+    mDecryptJob = 0;
+}
+
+bool VerifyNotification::showSignatures(int textIsSigned)
+{
+    verify_label_status verifyStatus=VERIFY_ERROR_OK;
 
-    if (sign == NULL) {
+    if (mSignatures.isEmpty()) {
         return false;
     }
 
     QString verifyLabelText;
     bool unknownKeyFound=false;
+    keysNotInList->clear();
 
-    while (sign) {
+    foreach (const GpgSignature &sign, mSignatures) {
 
-        switch (gpg_err_code(sign->status))
+        switch (gpg_err_code(sign.status))
         {
             case GPG_ERR_NO_PUBKEY:
             {
                 verifyStatus=VERIFY_ERROR_WARN;
-                verifyLabelText.append(tr("Key not present with id 0x")+QString(sign->fpr));
-                this->keysNotInList->append(sign->fpr);
+                verifyLabelText.append(tr("Key not present with id 0x")+sign.fpr);
+                this->keysNotInList->append(sign.fpr);
                 unknownKeyFound=true;
                 break;
             }
             case GPG_ERR_NO_ERROR:
             {
-                GpgKey key = mCtx->getKeyByFpr(sign->fpr);
+                GpgKey key = mCtx->getKeyByFpr(sign.fpr);
                 verifyLabelText.append(key.name);
                 if (!key.email.isEmpty()) {
                     verifyLabelText.append("<"+key.email+">");
@@ -134,7 +177,7 @@ bool VerifyNotification::slotRefresh()
             {
                 textIsSigned = 3;
                 verifyStatus=VERIFY_ERROR_CRITICAL;
-                GpgKey key = mCtx->getKeyById(sign->fpr);
+                GpgKey key = mCtx->getKeyById(sign.fpr);
                 verifyLabelText.append(key.name);
                 if (!key.email.isEmpty()) {
                     verifyLabelText.append("<"+key.email+">");
@@ -146,12 +189,11 @@ bool VerifyNotification::slotRefresh()
                 //textIsSigned = 3;
                 verifyStatus=VERIFY_ERROR_WARN;
                 //GpgKey key = mKeyList->getKeyByFpr(sign->fpr);
-                verifyLabelText.append(tr("Error for key with fingerprint ")+mCtx->beautifyFingerprint(QString(sign->fpr)));
+                verifyLabelText.append(tr("Error for key with fingerprint ")+mCtx->beautifyFingerprint(sign.fpr));
                 break;
             }
         }
         verifyLabelText.append("\n");
-        sign = sign->next;
     }
 
     switch (textIsSigned)
@@ -24,6 +24,7 @@
 
 #include "editorpage.h"
 #include "verifydetailsdialog.h"
+#include "gpgjob.h"
 #include <gpgme.h>
 #include <QWidget>
 
@@ -73,6 +74,15 @@ public:
      */
     void showImportAction(bool visible);
 
+    /**
+     * @details Show the signatures found while decrypting the text of the page,
+     * instead of verifying the text. cipherText is decrypted again, when a missing
+     * key of a signature is imported.
+     *
+     * @return false, if there are no signatures
+     */
+    bool setDecryptedSignatures(const GpgSignatureList &signatures, const QByteArray &cipherText);
+
     QStringList *keysNotInList; /** List with keys, which are in signature but not in keylist */
 
 
@@ -93,7 +103,12 @@ public slots:
      */
     bool slotRefresh();
 
+private slots:
+    void slotDecryptFinished();
+
 private:
+    bool showSignatures(int textIsSigned);
+
     QMenu *detailMenu; /** Menu for te Button in verfiyNotification */
     QAction *importFromKeyserverAct; /** Action for importing keys from keyserver which are notin keylist */
     QAction *showVerifyDetailsAct; /** Action for showing verify detail dialog */
@@ -104,6 +119,10 @@ private:
     QTextEdit *mTextpage; /** Textedit associated to the notification */
     QVector<QString> verifyDetailStringVector; /** Vector containing the text for labels in verifydetaildialog */
     QVector<verify_label_status> verifyDetailStatusVector; /** Vector containing the status for labels in verifydetaildialog */
+    GpgSignatureList mSignatures; /** Signatures shown in the notification */
+    bool mDecrypted; /** True, if the signatures were found while decrypting */
+    QByteArray mCipherText; /** The decrypted text, to check the signatures again */
+    GpgJob *mDecryptJob; /** decrypts mCipherText again, 0 if not running */
 
 };
 #endif // __VERIFYNOTIFICATION_H__
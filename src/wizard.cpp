@@ -78,28 +78,34 @@ bool Wizard::importPubAndSecKeysFromDir(const QString dir, KeyMgmt *keyMgmt)
         return false;
     }
 
-    QByteArray inBuffer;
+    // secret keys first, so the public keys are imported with known secret keys
+    QStringList fileNames;
     if (secRingFile.exists()) {
-        // write content of secringfile to inBuffer
         if (!secRingFile.open(QIODevice::ReadOnly)) {
             QMessageBox::critical(0, tr("Import error"), tr("Couldn't open private keyringfile: %1").arg(secRingFile.fileName()));
             return false;
         }
-        inBuffer = secRingFile.readAll();
         secRingFile.close();
+        fileNames << secRingFile.fileName();
     }
 
     if (pubRingFile.exists()) {
-        // try to import public keys
         if (!pubRingFile.open(QIODevice::ReadOnly)) {
             QMessageBox::critical(0, tr("Import error"), tr("Couldn't open public keyringfile: %1").arg(pubRingFile.fileName()));
             return false;
         }
-        inBuffer.append(pubRingFile.readAll());
         pubRingFile.close();
+        fileNames << pubRingFile.fileName();
+    }
+
+    // the keyrings are streamed to gpg in the background, not read into memory,
+    // but the caller restarts or moves on, so wait until the import is done
+    QPointer<GpgJob> job = keyMgmt->slotImportKeyFiles(fileNames);
+    QEventLoop loop;
+    QObject::connect(job, SIGNAL(finished()), &loop, SLOT(quit()));
+    if (!job->isFinished()) {
+        loop.exec();
     }
-    keyMgmt->slotImportKeys(inBuffer);
-    inBuffer.clear();
 
     return true;
 }
@@ -0,0 +1,37 @@
+######################################################################
+# Benchmarks for gpg4usb, run with runbenchmark.sh
+######################################################################
+
+CONFIG += qtestlib
+TEMPLATE = app
+TARGET = benchmark
+DEPENDPATH += .
+INCLUDEPATH += . ../../src
+
+# Input
+SOURCES += main.cpp \
+           benchmarkkeylist.cpp \
+           benchmarkcrypt.cpp \
+           benchmarkmime.cpp \
+           ../../src/gpgcontext.cpp \
+           ../../src/gpgconstants.cpp \
+           ../../src/gpgkeystore.cpp \
+           ../../src/gpgkeycache.cpp \
+           ../../src/gpgdata.cpp \
+           ../../src/keysearchindex.cpp \
+           ../../src/mime.cpp \
+           ../../src/mimedecoder.cpp
+HEADERS += benchmarkkeylist.h \
+           benchmarkcrypt.h \
+           benchmarkmime.h \
+           ../../src/gpgcontext.h \
+           ../../src/gpgconstants.h \
+           ../../src/gpgkeystore.h \
+           ../../src/gpgkeycache.h \
+           ../../src/gpgdata.h \
+           ../../src/keysearchindex.h \
+           ../../src/mime.h \
+           ../../src/mimedecoder.h
+
+LIBS += -lgpgme \
+     -lgpg-error \
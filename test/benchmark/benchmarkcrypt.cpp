@@ -0,0 +1,190 @@
+#include "benchmarkcrypt.h"
+#include "gpgcontext.h"
+
+void BenchmarkCrypt::initTestCase()
+{
+    mCtx = 0;
+    if (!QDir(qApp->applicationDirPath() + "/keydb/bench-crypt").exists()) {
+        return;
+    }
+
+    // GpgContext reads the keydb path from the settings
+    QSettings settings;
+    settings.setValue("gpgpaths/keydbpath", "bench-crypt");
+    mCtx = new GpgME::GpgContext();
+
+    // the first key can also sign, it is the only one in older keyrings
+    GpgKeyList keys = mCtx->listKeys();
+    foreach (const GpgKey &key, keys) {
+        if (key.privkey && mRecipients.isEmpty()) {
+            mRecipients << key.id;
+        }
+        mKeyIds << key.id;
+    }
+}
+
+void BenchmarkCrypt::cleanupTestCase()
+{
+    delete mCtx;
+}
+
+void BenchmarkCrypt::addSizes()
+{
+    QTest::addColumn<int>("size");
+
+    QTest::newRow("1 KB") << (1 << 10);
+    QTest::newRow("64 KB") << (1 << 16);
+    QTest::newRow("1 MB") << (1 << 20);
+    QTest::newRow("16 MB") << (1 << 24);
+    QTest::newRow("256 MB") << (1 << 28);
+    QTest::newRow("1 GB") << (1 << 30);
+}
+
+/**
+ * random data, so gpg can't compress it and the output is as large
+ * as in the worst case
+ */
+QByteArray BenchmarkCrypt::randomData(int size)
+{
+    QByteArray data;
+    data.resize(size);
+    char *p = data.data();
+    quint32 x = 2463534242u;
+    for (int i = 0; i < size; i++) {
+        // xorshift, qrand() is too slow for a gigabyte
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        p[i] = char(x);
+    }
+    return data;
+}
+
+void BenchmarkCrypt::encrypt_data()
+{
+    addSizes();
+}
+
+void BenchmarkCrypt::encrypt()
+{
+    QFETCH(int, size);
+
+    if (mRecipients.isEmpty()) {
+        QSKIP("keydb/bench-crypt not found, create it with runbenchmark.sh", SkipAll);
+    }
+
+    QByteArray in = randomData(size);
+    QByteArray out;
+
+    QBENCHMARK {
+        out.clear();
+        QVERIFY(mCtx->encrypt(&mRecipients, in, &out));
+    }
+    QVERIFY(out.size() > size);
+}
+
+void BenchmarkCrypt::decrypt_data()
+{
+    addSizes();
+}
+
+void BenchmarkCrypt::decrypt()
+{
+    QFETCH(int, size);
+
+    if (mRecipients.isEmpty()) {
+        QSKIP("keydb/bench-crypt not found, create it with runbenchmark.sh", SkipAll);
+    }
+
+    QByteArray in;
+    QVERIFY(mCtx->encrypt(&mRecipients, randomData(size), &in));
+    QByteArray out;
+
+    QBENCHMARK {
+        out.clear();
+        QVERIFY(mCtx->decrypt(in, &out));
+    }
+    QCOMPARE(out.size(), size);
+}
+
+void BenchmarkCrypt::sign_data()
+{
+    addSizes();
+}
+
+/**
+ * detached signatures, like for signing files
+ */
+void BenchmarkCrypt::sign()
+{
+    QFETCH(int, size);
+
+    if (mRecipients.isEmpty()) {
+        QSKIP("keydb/bench-crypt not found, create it with runbenchmark.sh", SkipAll);
+    }
+
+    QByteArray in = randomData(size);
+    QByteArray out;
+
+    QBENCHMARK {
+        out.clear();
+        QVERIFY(mCtx->sign(&mRecipients, in, &out, true));
+    }
+    QVERIFY(out.size() > 0);
+}
+
+void BenchmarkCrypt::verify_data()
+{
+    addSizes();
+}
+
+void BenchmarkCrypt::verify()
+{
+    QFETCH(int, size);
+
+    if (mRecipients.isEmpty()) {
+        QSKIP("keydb/bench-crypt not found, create it with runbenchmark.sh", SkipAll);
+    }
+
+    QByteArray in = randomData(size);
+    QByteArray sig;
+    QVERIFY(mCtx->sign(&mRecipients, in, &sig, true));
+    GpgSignatureList signatures;
+
+    QBENCHMARK {
+        signatures = mCtx->verify(&in, &sig);
+    }
+    QCOMPARE(signatures.size(), 1);
+    QVERIFY(signatures.first().status == GPG_ERR_NO_ERROR);
+}
+
+void BenchmarkCrypt::encryptRecipients_data()
+{
+    QTest::addColumn<int>("recipients");
+
+    QTest::newRow("1 recipient") << 1;
+    QTest::newRow("5 recipients") << 5;
+    QTest::newRow("20 recipients") << 20;
+}
+
+/**
+ * a small message, so the time is spent on the keys and not the data
+ */
+void BenchmarkCrypt::encryptRecipients()
+{
+    QFETCH(int, recipients);
+
+    if (mKeyIds.size() < recipients) {
+        QSKIP("keydb/bench-crypt has not enough keys, recreate it with runbenchmark.sh", SkipSingle);
+    }
+
+    QStringList uidList = mKeyIds.mid(0, recipients);
+    QByteArray in = randomData(1 << 16);
+    QByteArray out;
+
+    QBENCHMARK {
+        out.clear();
+        QVERIFY(mCtx->encrypt(&uidList, in, &out));
+    }
+    QVERIFY(out.size() > in.size());
+}
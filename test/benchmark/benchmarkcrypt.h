@@ -0,0 +1,43 @@
+#ifndef __BENCHMARKCRYPT_H__
+#define __BENCHMARKCRYPT_H__
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+namespace GpgME {
+class GpgContext;
+}
+
+/**
+* benchmark for the throughput of encrypting, decrypting, signing and verifying
+* buffers from 1 KB to 1 GB, and of encrypting for up to 20 recipients,
+* the keyring is created by runbenchmark.sh in keydb/bench-crypt
+*/
+class BenchmarkCrypt : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void encrypt_data();
+    void encrypt();
+    void decrypt_data();
+    void decrypt();
+    void sign_data();
+    void sign();
+    void verify_data();
+    void verify();
+    void encryptRecipients_data();
+    void encryptRecipients();
+
+private:
+    void addSizes();
+    QByteArray randomData(int size);
+
+    GpgME::GpgContext *mCtx;
+    QStringList mRecipients;
+    QStringList mKeyIds; /** all keys of the keyring */
+};
+
+#endif // __BENCHMARKCRYPT_H__
@@ -0,0 +1,97 @@
+#include "benchmarkkeylist.h"
+#include "gpgcontext.h"
+
+void BenchmarkKeyList::listKeys_data()
+{
+    QTest::addColumn<int>("keyCount");
+
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("50k") << 50000;
+}
+
+void BenchmarkKeyList::listKeys()
+{
+    QFETCH(int, keyCount);
+
+    QString keydb = QString("bench-%1").arg(keyCount);
+    if (!QDir(qApp->applicationDirPath() + "/keydb/" + keydb).exists()) {
+        QSKIP(qPrintable("keydb/" + keydb + " not found, create it with runbenchmark.sh"), SkipSingle);
+    }
+
+    // GpgContext reads the keydb path from the settings
+    QSettings settings;
+    settings.setValue("gpgpaths/keydbpath", keydb);
+    GpgME::GpgContext ctx;
+
+    QCOMPARE(ctx.listKeys().size(), keyCount);
+
+    QBENCHMARK {
+        ctx.listKeys();
+    }
+}
+
+void BenchmarkKeyList::importKey_data()
+{
+    QTest::addColumn<int>("keyCount");
+
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+}
+
+/**
+ * every iteration imports into a new, empty keyring, the time includes
+ * the refresh of the keylist after the import, as in the gui
+ */
+void BenchmarkKeyList::importKey()
+{
+    QFETCH(int, keyCount);
+
+    QString keydb = QString("bench-%1").arg(keyCount);
+    if (!QDir(qApp->applicationDirPath() + "/keydb/" + keydb).exists()) {
+        QSKIP(qPrintable("keydb/" + keydb + " not found, create it with runbenchmark.sh"), SkipSingle);
+    }
+
+    QSettings settings;
+    settings.setValue("gpgpaths/keydbpath", keydb);
+    QByteArray keys;
+    {
+        GpgME::GpgContext ctx;
+        QStringList fprs;
+        foreach (const GpgKey &key, ctx.listKeys()) {
+            fprs.append(key.fpr);
+        }
+        QVERIFY(ctx.exportKeys(&fprs, &keys));
+    }
+
+    int iteration = 0;
+    GpgImportInformation result;
+    QBENCHMARK {
+        QString importKeydb = QString("bench-import-%1-%2").arg(keyCount).arg(iteration++);
+        QString path = qApp->applicationDirPath() + "/keydb/" + importKeydb;
+        QDir().mkpath(path);
+        QFile::setPermissions(path, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+        settings.setValue("gpgpaths/keydbpath", importKeydb);
+
+        GpgME::GpgContext ctx;
+        result = ctx.importKey(keys);
+    }
+    QCOMPARE(result.imported, keyCount);
+
+    for (int i = 0; i < iteration; i++) {
+        removeKeydb(qApp->applicationDirPath() + QString("/keydb/bench-import-%1-%2").arg(keyCount).arg(i));
+    }
+}
+
+void BenchmarkKeyList::removeKeydb(const QString &path)
+{
+    QDir dir(path);
+    foreach (QFileInfo info, dir.entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot)) {
+        if (info.isDir()) {
+            removeKeydb(info.filePath());
+        } else {
+            dir.remove(info.fileName());
+        }
+    }
+    dir.rmdir(path);
+}
@@ -0,0 +1,26 @@
+#ifndef __BENCHMARKKEYLIST_H__
+#define __BENCHMARKKEYLIST_H__
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+/**
+* benchmark for listing the keys of keyrings with 1000, 10000 and 50000 keys,
+* and for importing them into an empty keyring, the keyrings are created by
+* runbenchmark.sh in keydb/bench-<count>
+*/
+class BenchmarkKeyList : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void listKeys_data();
+    void listKeys();
+    void importKey_data();
+    void importKey();
+
+private:
+    void removeKeydb(const QString &path);
+};
+
+#endif // __BENCHMARKKEYLIST_H__
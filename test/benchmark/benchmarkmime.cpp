@@ -0,0 +1,245 @@
+#include "benchmarkmime.h"
+#include "mimedecoder.h"
+#include "mime.h"
+#include "gpgcontext.h"
+
+/***
+ * legacyQuotedPrintableDecode is the decoder used before MimeDecoder, copied
+ * from KCodecs, where it is stated:
+
+   The quoted-printable codec as described in RFC 2045, section 6.7. is by
+   Rik Hemsley (C) 2001.
+
+ */
+
+static const char hexChars[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7',
+    '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+// strchr(3) for broken systems.
+static int rikFindChar(register const char * _s, const char c)
+{
+    register const char * s = _s;
+
+    while (true) {
+        if ((0 == *s) || (c == *s)) break; ++s;
+        if ((0 == *s) || (c == *s)) break; ++s;
+        if ((0 == *s) || (c == *s)) break; ++s;
+        if ((0 == *s) || (c == *s)) break; ++s;
+    }
+
+    return s - _s;
+}
+
+static void legacyQuotedPrintableDecode(const QByteArray& in, QByteArray& out)
+{
+    out.resize(0);
+    if (in.isEmpty())
+        return;
+
+    char *cursor;
+    const unsigned int length = in.size();
+
+    out.resize(length);
+    cursor = out.data();
+
+    for (unsigned int i = 0; i < length; i++) {
+        char c(in[i]);
+
+        if ('=' == c) {
+            if (i < length - 2) {
+                char c1 = in[i + 1];
+                char c2 = in[i + 2];
+
+                if (('\n' == c1) || ('\r' == c1 && '\n' == c2)) {
+                    // Soft line break. No output.
+                    if ('\r' == c1)
+                        i += 2;        // CRLF line breaks
+                    else
+                        i += 1;
+                } else {
+                    // =XX encoded byte.
+
+                    int hexChar0 = rikFindChar(hexChars, c1);
+                    int hexChar1 = rikFindChar(hexChars, c2);
+
+                    if (hexChar0 < 16 && hexChar1 < 16) {
+                        *cursor++ = char((hexChar0 * 16) | hexChar1);
+                        i += 2;
+                    }
+                }
+            }
+        } else {
+            *cursor++ = c;
+        }
+    }
+
+    out.truncate(cursor - out.data());
+}
+
+/**
+ * random bytes, so about 2/3 of the quoted-printable text are escapes
+ */
+static QByteArray randomData(int size)
+{
+    QByteArray data;
+    data.resize(size);
+    char *p = data.data();
+    quint32 x = 2463534242u;
+    for (int i = 0; i < size; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        p[i] = char(x);
+    }
+    return data;
+}
+
+/**
+ * a multipart/mixed message with parts base64 attachments, the last part
+ * is again such a message, until depth is reached
+ */
+static QByteArray multipartMessage(int parts, int partSize, int depth)
+{
+    QByteArray base64 = randomData(partSize).toBase64();
+    QByteArray body;
+    for (int i = 0; i < base64.size(); i += 76) {
+        body.append(base64.constData() + i, qMin(76, base64.size() - i));
+        body.append('\n');
+    }
+
+    QByteArray boundary = "boundary-" + QByteArray::number(depth);
+    QByteArray message = "Content-Type: multipart/mixed; boundary=\"" + boundary + "\"\n\n";
+    for (int i = 0; i < parts; i++) {
+        message += "--" + boundary + "\n"
+                   "Content-Type: application/octet-stream\n"
+                   "Content-Transfer-Encoding: base64\n\n" + body;
+    }
+    if (depth > 1) {
+        message += "--" + boundary + "\n" + multipartMessage(parts, partSize, depth - 1);
+    }
+    message += "--" + boundary + "--\n";
+    return message;
+}
+
+void BenchmarkMime::initTestCase()
+{
+    if (!QDir(qApp->applicationDirPath() + "/keydb/bench-testdata").exists()) {
+        return;
+    }
+
+    QFile file(qApp->applicationDirPath() + "/../../testdata/multipart-mime2-joe.asc");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    // GpgContext reads the keydb path from the settings
+    QSettings settings;
+    settings.setValue("gpgpaths/keydbpath", "bench-testdata");
+    GpgME::GpgContext ctx;
+    // the password of testdata/seckey-1.asc
+    ctx.setPassword("x");
+    ctx.decrypt(file.readAll(), &mTestdataMessage);
+}
+
+void BenchmarkMime::addRows()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("legacy");
+
+    QTest::newRow("1 MB, before") << (1 << 20) << true;
+    QTest::newRow("1 MB, MimeDecoder") << (1 << 20) << false;
+    QTest::newRow("64 MB, before") << (1 << 26) << true;
+    QTest::newRow("64 MB, MimeDecoder") << (1 << 26) << false;
+}
+
+void BenchmarkMime::quotedPrintable_data()
+{
+    addRows();
+}
+
+void BenchmarkMime::quotedPrintable()
+{
+    QFETCH(int, size);
+    QFETCH(bool, legacy);
+
+    QByteArray escaped = randomData(size).toPercentEncoding(QByteArray(), QByteArray(), '=');
+    // soft line breaks after 75 characters, like in real quoted-printable text
+    QByteArray encoded;
+    encoded.reserve(escaped.size() + escaped.size() / 75 * 2 + 2);
+    for (int i = 0; i < escaped.size(); i += 75) {
+        encoded.append(escaped.constData() + i, qMin(75, escaped.size() - i));
+        encoded.append("=\n");
+    }
+
+    QByteArray decoded;
+    if (legacy) {
+        QBENCHMARK {
+            legacyQuotedPrintableDecode(encoded, decoded);
+        }
+    } else {
+        QBENCHMARK {
+            Mime::quotedPrintableDecode(encoded, decoded);
+        }
+    }
+    QVERIFY(decoded.size() > 0);
+}
+
+void BenchmarkMime::base64_data()
+{
+    addRows();
+}
+
+void BenchmarkMime::base64()
+{
+    QFETCH(int, size);
+    QFETCH(bool, legacy);
+
+    QByteArray base64 = randomData(size).toBase64();
+    // line breaks after 76 characters, like in attachments
+    QByteArray encoded;
+    encoded.reserve(base64.size() + base64.size() / 76 + 1);
+    for (int i = 0; i < base64.size(); i += 76) {
+        encoded.append(base64.constData() + i, qMin(76, base64.size() - i));
+        encoded.append('\n');
+    }
+
+    QByteArray decoded;
+    if (legacy) {
+        QBENCHMARK {
+            decoded = QByteArray::fromBase64(encoded);
+        }
+    } else {
+        QBENCHMARK {
+            decoded = MimeDecoder::decode(MimeDecoder::Base64, encoded);
+        }
+    }
+    QCOMPARE(decoded.size(), size);
+}
+
+void BenchmarkMime::splitParts_data()
+{
+    QTest::addColumn<QByteArray>("message");
+
+    QTest::newRow("testdata multipart-mime2") << mTestdataMessage;
+    QTest::newRow("100 parts of 64 KB") << multipartMessage(100, 1 << 16, 1);
+    QTest::newRow("10000 parts of 1 KB") << multipartMessage(10000, 1 << 10, 1);
+    QTest::newRow("15 levels of 10 parts") << multipartMessage(10, 1 << 10, 15);
+}
+
+void BenchmarkMime::splitParts()
+{
+    QFETCH(QByteArray, message);
+
+    if (message.isEmpty()) {
+        QSKIP("testdata could not be decrypted, create keydb/bench-testdata with runbenchmark.sh", SkipSingle);
+    }
+
+    int partCount = 0;
+    QBENCHMARK {
+        Mime mime(message);
+        partCount = mime.parts().size();
+    }
+    QVERIFY(partCount > 1);
+}
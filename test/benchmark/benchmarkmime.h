@@ -0,0 +1,32 @@
+#ifndef __BENCHMARKMIME_H__
+#define __BENCHMARKMIME_H__
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+/**
+* benchmark for the throughput of the quoted-printable and base64 decoders of
+* MimeDecoder, compared with the decoders used before, and for splitting
+* messages into parts, the real message is decrypted from testdata/ with the
+* keyring created by runbenchmark.sh in keydb/bench-testdata
+*/
+class BenchmarkMime : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void quotedPrintable_data();
+    void quotedPrintable();
+    void base64_data();
+    void base64();
+    void splitParts_data();
+    void splitParts();
+
+private:
+    void addRows();
+
+    QByteArray mTestdataMessage;
+};
+
+#endif // __BENCHMARKMIME_H__
@@ -0,0 +1,48 @@
+#include <QtTest/QtTest>
+#include "benchmarkkeylist.h"
+#include "benchmarkcrypt.h"
+#include "benchmarkmime.h"
+
+/**
+* runs all benchmarks, every benchmark class is a QTest test object,
+* have a look at http://doc.qt.nokia.com/latest/qtestlib-tutorial5.html
+*
+* all QTest arguments are passed on, e.g. -xml for machine readable output.
+* with -outdir DIR the results of every class are written to an own file,
+* e.g. DIR/BenchmarkCrypt.xml, so they can be compared between runs.
+*/
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    app.setOrganizationName("gpg4usb-benchmark");
+    app.setApplicationName("benchmark");
+
+    QStringList args = app.arguments();
+    QString outDir;
+    int outDirIndex = args.indexOf("-outdir");
+    if (outDirIndex > 0 && outDirIndex + 1 < args.size()) {
+        outDir = args.at(outDirIndex + 1);
+        args.removeAt(outDirIndex + 1);
+        args.removeAt(outDirIndex);
+        QDir().mkpath(outDir);
+    }
+    bool xml = args.contains("-xml") || args.contains("-lightxml") || args.contains("-xunitxml");
+
+    BenchmarkKeyList keyList;
+    BenchmarkCrypt crypt;
+    BenchmarkMime mime;
+    QList<QObject *> benchmarks;
+    benchmarks << &keyList << &crypt << &mime;
+
+    int result = 0;
+    foreach (QObject *benchmark, benchmarks) {
+        QStringList benchmarkArgs = args;
+        if (!outDir.isEmpty()) {
+            benchmarkArgs << "-o" << outDir + "/" + benchmark->metaObject()->className()
+                          + (xml ? ".xml" : ".txt");
+        }
+        result |= QTest::qExec(benchmark, benchmarkArgs);
+    }
+
+    return result;
+}
@@ -0,0 +1,59 @@
+#!/bin/bash
+
+# the keyrings have to be created with the gpg used by gpg4usb, gpg >= 2.1
+# writes a pubring.kbx, which gpg 1.4 can't read
+gpg=./bin/gpg
+
+# create the keyrings for the keylist benchmark, this takes a while for
+# the larger ones, so they are kept between runs
+for count in 1000 10000 50000; do
+    keydb=keydb/bench-$count
+    if [ -f $keydb/pubring.gpg ]; then
+        continue
+    fi
+    rm -rf $keydb
+    mkdir -p $keydb
+    chmod 700 $keydb
+    # without Passphrase, gpg 1.4 doesn't protect the keys
+    for i in $(seq 1 $count); do
+        echo "Key-Type: RSA"
+        echo "Key-Length: 1024"
+        echo "Name-Real: Benchmark $i"
+        echo "Name-Email: benchmark$i@example.org"
+        echo "Expire-Date: 0"
+        echo "%commit"
+    done | $gpg --homedir $keydb --batch --quiet --gen-key
+done
+
+# keys for the crypt benchmarks, the first one also signs, all of them
+# are recipients for the benchmark with many recipients
+keydb=keydb/bench-crypt
+if [ ! -f $keydb/pubring.gpg ]; then
+    rm -rf $keydb
+    mkdir -p $keydb
+    chmod 700 $keydb
+    for i in $(seq 1 20); do
+        echo "Key-Type: RSA"
+        echo "Key-Length: 2048"
+        echo "Subkey-Type: RSA"
+        echo "Subkey-Length: 2048"
+        echo "Name-Real: Benchmark Crypt $i"
+        echo "Name-Email: crypt$i@example.org"
+        echo "Expire-Date: 0"
+        echo "%commit"
+    done | $gpg --homedir $keydb --batch --quiet --gen-key
+fi
+
+# a throwaway keyring with the key of testdata/, to decrypt the messages there
+keydb=keydb/bench-testdata
+rm -rf $keydb
+mkdir -p $keydb
+chmod 700 $keydb
+$gpg --homedir $keydb --batch --quiet --import ../../testdata/seckey-1.asc
+
+#make clean
+#qmake
+make
+
+# e.g. ./runbenchmark.sh -xml -outdir results/$(date +%F)
+./benchmark "$@"
@@ -3,6 +3,7 @@
 ######################################################################
 
 CONFIG += qtestlib
+QT += network
 TEMPLATE = app
 TARGET = 
 DEPENDPATH += .
@@ -11,10 +12,28 @@ INCLUDEPATH += .
 
 # Input
 SOURCES += testgpgcontext.cpp \
-           ../gpgcontext.cpp \
-           ../gpgconstants.cpp
-HEADERS += ../gpgcontext.h \
-           ../gpgconstants.h
+           ../src/gpgcontext.cpp \
+           ../src/gpgconstants.cpp \
+           ../src/gpgkeystore.cpp \
+           ../src/gpgkeycache.cpp \
+           ../src/gpgdata.cpp \
+           ../src/keysearchindex.cpp \
+           ../src/mime.cpp \
+           ../src/mimedecoder.cpp \
+           ../src/mimeencoder.cpp \
+           ../src/gpgcontextpool.cpp \
+           ../src/gpgserver.cpp
+HEADERS += ../src/gpgcontext.h \
+           ../src/gpgconstants.h \
+           ../src/gpgkeystore.h \
+           ../src/gpgkeycache.h \
+           ../src/gpgdata.h \
+           ../src/keysearchindex.h \
+           ../src/mime.h \
+           ../src/mimedecoder.h \
+           ../src/mimeencoder.h \
+           ../src/gpgcontextpool.h \
+           ../src/gpgserver.h
 
 LIBS += -lgpgme \
      -lgpg-error \
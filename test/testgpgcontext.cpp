@@ -1,6 +1,10 @@
 #include <QObject>
 #include <QtTest/QtTest>
-#include <../gpgcontext.h>
+#include <../src/gpgcontext.h>
+#include <../src/mime.h>
+#include <../src/mimedecoder.h>
+#include <../src/mimeencoder.h>
+#include <../src/gpgserver.h>
 
 /**
 * unit test for gpgcontext,
@@ -18,6 +22,16 @@ private:
 
 private slots:
     void passwordSize();
+    void keyStoreLookup();
+    void keySearch();
+    void gpgDataBuffer();
+    void mimeParts();
+    void mimeNestedParts();
+    void mimeDecoder();
+    void mimeHeader();
+    void mimeEncoder();
+    void importKeyFile();
+    void serverProtocol();
 
 };
 
@@ -58,5 +72,433 @@ void TestGpgContext::passwordSize() {
         qDebug() << "done.";*/
 }
 
+void TestGpgContext::keyStoreLookup() {
+
+        GpgKeyStore store;
+        GpgKeyList keys;
+        for (int i = 0; i < 3; i++) {
+            GpgKey key;
+            key.fpr = QString("FPR%1").arg(i);
+            key.id = QString("ID%1").arg(i);
+            key.email = QString("User%1@example.org").arg(i % 2);
+            keys.append(key);
+        }
+        store.sync(keys);
+
+        QCOMPARE(store.size(), 3);
+        QCOMPARE(store.findByFpr("FPR1")->id, QString("ID1"));
+        QCOMPARE(store.findById("ID2")->fpr, QString("FPR2"));
+        QCOMPARE(store.findByEmail("user0@example.org").size(), 2);
+
+        // removing a key in the middle must keep the other indexes valid
+        QVERIFY(store.remove("FPR0"));
+        QVERIFY(store.findByFpr("FPR0") == NULL);
+        QCOMPARE(store.findByFpr("FPR2")->id, QString("ID2"));
+        QCOMPARE(store.findByEmail("user0@example.org").size(), 1);
+
+        keys.remove(0);
+        keys.first().name = "renamed";
+        store.sync(keys);
+        QCOMPARE(store.size(), 2);
+        QCOMPARE(store.findById("ID1")->name, QString("renamed"));
+
+        // names given by the user, e.g. on the command line
+        QCOMPARE(store.findByName("0xfpr2")->id, QString("ID2"));
+        QCOMPARE(store.findByName("USER1@example.org")->fpr, QString("FPR1"));
+        QVERIFY(store.findByName("ID1", true) == NULL);
+
+        // unchanged keys are not signaled, so models are not touched
+        QSignalSpy changedSpy(&store, SIGNAL(signalKeyChanged(int)));
+        QSignalSpy insertedSpy(&store, SIGNAL(signalKeyInserted(int)));
+        store.sync(keys);
+        QCOMPARE(changedSpy.count(), 0);
+        QCOMPARE(insertedSpy.count(), 0);
+
+        // many new keys reset the store once, instead of a signal per key
+        QSignalSpy resetSpy(&store, SIGNAL(signalReset()));
+        KeySearchIndex index(&store);
+        for (int i = 3; i < 203; i++) {
+            GpgKey key;
+            key.fpr = QString("FPR%1").arg(i);
+            key.id = QString("ID%1").arg(i);
+            key.email = QString("bulk%1@example.org").arg(i);
+            keys.append(key);
+        }
+        store.sync(keys);
+        QCOMPARE(resetSpy.count(), 1);
+        QCOMPARE(insertedSpy.count(), 0);
+        QCOMPARE(store.size(), 202);
+        QCOMPARE(store.findById("ID1")->name, QString("renamed"));
+        QCOMPARE(store.findByFpr("FPR202")->id, QString("ID202"));
+        QCOMPARE(index.search("bulk").size(), 200);
+}
+
+void TestGpgContext::keySearch() {
+
+        GpgKeyStore store;
+        KeySearchIndex index(&store);
+
+        GpgKey alice;
+        alice.name = "Alice Liddell";
+        alice.email = "alice@example.org";
+        alice.id = "0123456789ABCDEF";
+        alice.fpr = "AAAA0123456789ABCDEF";
+        store.insert(alice);
+
+        GpgKey bob;
+        bob.name = "Bob Builder";
+        bob.email = "bob@example.net";
+        bob.id = "FEDCBA9876543210";
+        bob.fpr = "BBBBFEDCBA9876543210";
+        store.insert(bob);
+
+        // short queries match the beginning of words
+        QCOMPARE(index.search("li").size(), 1);
+        QCOMPARE(index.search("b").size(), 1);
+        QCOMPARE(index.search("ex").size(), 2);
+
+        // longer ones match anywhere, case insensitive
+        QCOMPARE(index.search("DELL").size(), 1);
+        QCOMPARE(index.search("89abcd").size(), 1);
+        QCOMPARE(index.search("example").size(), 2);
+        QCOMPARE(index.search("xyz").size(), 0);
+
+        // the index follows the store
+        store.remove(alice.fpr);
+        QCOMPARE(index.search("example").size(), 1);
+        bob.name = "Robert Builder";
+        store.insert(bob);
+        QCOMPARE(index.search("robert").size(), 1);
+        QCOMPARE(index.search("ro").size(), 1);
+
+        QVERIFY(KeySearchIndex::isNarrowing("exa", "example"));
+        QVERIFY(!KeySearchIndex::isNarrowing("ex", "example"));
+}
+
+void TestGpgContext::gpgDataBuffer() {
+
+        QByteArray input("0123456789");
+        char buf[16];
+        {
+            GpgData in(input);
+            QCOMPARE(in.error(), gpgme_error_t(GPG_ERR_NO_ERROR));
+            QCOMPARE(int(gpgme_data_read(in.data(), buf, 4)), 4);
+            QCOMPARE(QByteArray(buf, 4), QByteArray("0123"));
+            QCOMPARE(int(gpgme_data_seek(in.data(), -2, SEEK_END)), 8);
+            QCOMPARE(int(gpgme_data_read(in.data(), buf, sizeof(buf))), 2);
+            QCOMPARE(int(gpgme_data_read(in.data(), buf, sizeof(buf))), 0);
+            // the input is read only
+            QVERIFY(gpgme_data_write(in.data(), "x", 1) < 0);
+        }
+
+        // output is appended to existing content
+        QByteArray output("head:");
+        {
+            GpgData out(&output);
+            QCOMPARE(int(gpgme_data_write(out.data(), "abc", 3)), 3);
+            QCOMPARE(int(gpgme_data_write(out.data(), "def", 3)), 3);
+            gpgme_data_seek(out.data(), 1, SEEK_SET);
+            QCOMPARE(int(gpgme_data_write(out.data(), "B", 1)), 1);
+        }
+        QCOMPARE(output, QByteArray("head:aBcdef"));
+}
+
+void TestGpgContext::mimeParts() {
+
+        QByteArray message(
+            "Content-Type: multipart/mixed; boundary=\"XyZ\"\n"
+            "\n"
+            "--XyZ\n"
+            "Content-Type: text/plain\n"
+            "Content-Transfer-Encoding: quoted-printable\n"
+            "\n"
+            "caf=C3=A9 =\n"
+            "au lait\n"
+            "--XyZ\n"
+            "Content-Type: application/octet-stream; name=\"a.bin\"\n"
+            "Content-Transfer-Encoding: base64\n"
+            "\n"
+            "aGVsbG8=\n"
+            "--XyZ--\n");
+
+        Mime mime(message);
+        const QList<MimePart> &parts = mime.parts();
+        QCOMPARE(parts.size(), 2);
+        QCOMPARE(parts.at(0).header.getValue("Content-Type"), QString("text/plain"));
+        QCOMPARE(parts.at(0).body(), QByteArray("caf=C3=A9 =\nau lait"));
+        QCOMPARE(parts.at(0).decodedBody(), QByteArray("caf\xc3\xa9 au lait"));
+        QCOMPARE(parts.at(1).decodedBody(), QByteArray("hello"));
+
+        // the bodies are not copied
+        QCOMPARE(parts.at(1).message.constData(), message.constData());
+}
+
+void TestGpgContext::mimeNestedParts() {
+
+        // CRLF line breaks, an unquoted boundary with = and a nested alternative
+        QByteArray message(
+            "Content-Type: multipart/mixed; boundary=outer=1\r\n"
+            "\r\n"
+            "preamble --outer=1 not at line start\r\n"
+            "--outer=1\r\n"
+            "Content-Type: multipart/alternative; boundary=\"inner\"\r\n"
+            "\r\n"
+            "--inner\r\n"
+            "Content-Type: text/plain\r\n"
+            "\r\n"
+            "plain\r\n"
+            "--inner\r\n"
+            "Content-Type: text/html\r\n"
+            "\r\n"
+            "<b>html</b>\r\n"
+            "--inner--\r\n"
+            "--outer=1  \r\n"
+            "Content-Type: application/octet-stream\r\n"
+            "\r\n"
+            "data\r\n"
+            "--outer=1--\r\n"
+            "epilogue\r\n");
+
+        Mime mime(message);
+        QCOMPARE(mime.root().children.size(), 2);
+        QCOMPARE(mime.root().children.at(0).children.size(), 2);
+        QCOMPARE(mime.root().children.at(0).children.at(1).body(), QByteArray("<b>html</b>"));
+
+        // of the alternatives only the plain text is shown
+        const QList<MimePart> &parts = mime.parts();
+        QCOMPARE(parts.size(), 2);
+        QCOMPARE(parts.at(0).body(), QByteArray("plain"));
+        QCOMPARE(parts.at(1).header.getValue("Content-Type"), QString("application/octet-stream"));
+        QCOMPARE(parts.at(1).body(), QByteArray("data"));
+}
+
+void TestGpgContext::mimeDecoder() {
+
+        QByteArray plain;
+        for (int i = 0; i < 1000; i++) {
+            plain.append(char(i * 7));
+        }
+        QByteArray base64 = plain.toBase64();
+        for (int i = 76; i < base64.size(); i += 77) {
+            base64.insert(i, '\n');
+        }
+        QCOMPARE(MimeDecoder::decode(MimeDecoder::Base64, base64), plain);
+
+        QByteArray qp("caf=C3=A9 au=\r\n lait=3d=3D =\nok=");
+        QByteArray qpPlain("caf\xc3\xa9 au lait== ok");
+        QCOMPARE(MimeDecoder::decode(MimeDecoder::QuotedPrintable, qp), qpPlain);
+
+        // the result doesn't depend on how the input is split into chunks
+        for (int chunk = 1; chunk <= 5; chunk++) {
+            MimeDecoder base64Decoder(MimeDecoder::Base64);
+            MimeDecoder qpDecoder(MimeDecoder::QuotedPrintable);
+            QByteArray base64Out, qpOut;
+            for (int i = 0; i < base64.size(); i += chunk) {
+                base64Decoder.decode(base64.constData() + i, qMin(chunk, base64.size() - i), &base64Out);
+            }
+            for (int i = 0; i < qp.size(); i += chunk) {
+                qpDecoder.decode(qp.constData() + i, qMin(chunk, qp.size() - i), &qpOut);
+            }
+            base64Decoder.finish(&base64Out);
+            qpDecoder.finish(&qpOut);
+            QCOMPARE(base64Out, plain);
+            QCOMPARE(qpOut, qpPlain);
+        }
+
+        // a soft line break at the end of the input, also split between the chunks
+        QByteArray qpSoftEnd("soft=\r\n");
+        QCOMPARE(MimeDecoder::decode(MimeDecoder::QuotedPrintable, qpSoftEnd), QByteArray("soft"));
+        QCOMPARE(MimeDecoder::decode(MimeDecoder::QuotedPrintable, "soft=\n"), QByteArray("soft"));
+        for (int split = 1; split < qpSoftEnd.size(); split++) {
+            MimeDecoder qpDecoder(MimeDecoder::QuotedPrintable);
+            QByteArray qpOut;
+            qpDecoder.decode(qpSoftEnd.constData(), split, &qpOut);
+            qpDecoder.decode(qpSoftEnd.constData() + split, qpSoftEnd.size() - split, &qpOut);
+            qpDecoder.finish(&qpOut);
+            QCOMPARE(qpOut, QByteArray("soft"));
+        }
+
+        QBuffer file;
+        file.open(QIODevice::WriteOnly);
+        MimeDecoder decoder(MimeDecoder::Base64);
+        QVERIFY(decoder.decodeToDevice(base64.constData(), base64.size(), &file));
+        QCOMPARE(file.data(), plain);
+}
+
+void TestGpgContext::mimeHeader() {
+
+        QByteArray header(
+            "content-type: text/plain; charset=\"utf-8\"; name=\"a;b=c.txt\"\r\n"
+            "Content-Disposition: attachment;\r\n"
+            "\tfilename*0*=utf-8''%E2%82%AC; filename*1=\" rate.txt\"\r\n"
+            "Subject: a; b\r\n"
+            "Content-Type: text/html");
+        Header h = Mime::parseHeader(&header);
+
+        // names are case insensitive, the first field of a name is found
+        QCOMPARE(h.getValue("Content-Type"), QString("text/plain"));
+        QCOMPARE(h.getParam("CONTENT-TYPE", "Name"), QString("a;b=c.txt"));
+        QCOMPARE(h.getParam("Content-Type", "charset"), QString("utf-8"));
+        // RFC 2231 sections and charset
+        QCOMPARE(h.getParam("Content-Disposition", "filename"), QString::fromUtf8("\xe2\x82\xac rate.txt"));
+        // only Content- fields have parameters
+        QCOMPARE(h.getValue("subject"), QString("a; b"));
+        QVERIFY(h.find("X-Missing") == 0);
+        QVERIFY(h.getParams("X-Missing").isEmpty());
+}
+
+void TestGpgContext::mimeEncoder() {
+
+        QByteArray data;
+        for (int i = 0; i < 100000; i++) {
+            data.append(char(i * 13));
+        }
+        QString dataName = QDir::temp().filePath(QString::fromUtf8("gpg4usb-mime-\xc3\xa4.bin"));
+        QString emptyName = QDir::temp().filePath("gpg4usb-mime-empty.txt");
+        QFile dataFile(dataName);
+        QVERIFY(dataFile.open(QIODevice::WriteOnly));
+        dataFile.write(data);
+        dataFile.close();
+        QFile emptyFile(emptyName);
+        QVERIFY(emptyFile.open(QIODevice::WriteOnly));
+        emptyFile.close();
+
+        MimeEncoder encoder(QByteArray("text \xc3\xa4\n"), QStringList() << dataName << emptyName);
+        QVERIFY(encoder.open(QIODevice::ReadOnly));
+        // read in small pieces, like gpgme does
+        QByteArray message;
+        char buffer[1000];
+        qint64 len;
+        while ((len = encoder.read(buffer, sizeof(buffer))) > 0) {
+            message.append(buffer, len);
+        }
+        QVERIFY(!encoder.hasError());
+        QVERIFY(encoder.atEnd());
+        QFile::remove(dataName);
+        QFile::remove(emptyName);
+
+        Mime mime(message);
+        const QList<MimePart> &parts = mime.parts();
+        QCOMPARE(parts.size(), 3);
+        QCOMPARE(parts.at(0).body(), QByteArray("text \xc3\xa4\n"));
+        QCOMPARE(parts.at(1).fileName(), QString::fromUtf8("gpg4usb-mime-\xc3\xa4.bin"));
+        QCOMPARE(parts.at(1).decodedBody(), data);
+        QCOMPARE(parts.at(2).fileName(), QString("gpg4usb-mime-empty.txt"));
+        QCOMPARE(parts.at(2).header.getValue("Content-Type"), QString("text/plain"));
+        QVERIFY(parts.at(2).body().isEmpty());
+
+        QCOMPARE(MimeEncoder::formatParam("name", "a \"b\""), QByteArray("name=\"a \\\"b\\\"\""));
+
+        // missing files are reported before anything is read
+        MimeEncoder missing(QByteArray(), QStringList() << emptyName);
+        QVERIFY(!missing.open(QIODevice::ReadOnly));
+}
+
+void TestGpgContext::importKeyFile() {
+
+        // imported by passwordSize() already
+        QFile file("../testdata/seckey-1.asc");
+        QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Unbuffered));
+
+        // the keylist is not refreshed until notifyKeyDBChanged()
+        QSignalSpy changedSpy(mCtx, SIGNAL(signalKeyDBChanged(QStringList)));
+        QSignalSpy progressSpy(mCtx, SIGNAL(signalProgress(int,int)));
+        GpgImportInformation result = mCtx->importKeyFile(&file);
+        QCOMPARE(result.considered, 1);
+        QVERIFY(result.changedFingerprints().isEmpty());
+        QCOMPARE(changedSpy.count(), 0);
+        QVERIFY(progressSpy.count() > 0);
+        QCOMPARE(progressSpy.last().at(0).toInt(), 1000);
+
+        GpgImportInformation total;
+        total += result;
+        total += result;
+        QCOMPARE(total.considered, 2);
+        QCOMPARE(total.importedKeys.size(), 2 * result.importedKeys.size());
+
+        // changes are collected and applied at once
+        QStringList fprs;
+        fprs << result.importedKeys.first().fpr;
+        mCtx->notifyKeyDBChanged(fprs);
+        mCtx->notifyKeyDBChanged(fprs);
+        QCOMPARE(changedSpy.count(), 0);
+        QTest::qWait(500);
+        QCOMPARE(changedSpy.count(), 1);
+        QCOMPARE(changedSpy.first().at(0).toStringList(), fprs);
+        QVERIFY(mCtx->getKeyByFpr(fprs.first()).privkey);
+
+        // nothing pending, nothing emitted
+        mCtx->slotFlushKeyDBChanged();
+        QCOMPARE(changedSpy.count(), 1);
+}
+
+/** Wait for the next response of the GpgServer, the server runs in this thread
+ *  too, so the events have to be processed while waiting.
+ */
+static QList<QByteArray> readServerResponse(QLocalSocket *socket, QByteArray *body)
+{
+    for (int i = 0; i < 250 && !socket->canReadLine(); i++) {
+        QTest::qWait(20);
+    }
+    QList<QByteArray> fields = socket->readLine().trimmed().split(' ');
+    if (fields.size() != 4) {
+        return fields;
+    }
+    int length = fields.at(2).toInt();
+    for (int i = 0; i < 250 && socket->bytesAvailable() < length; i++) {
+        QTest::qWait(20);
+    }
+    *body = socket->read(length);
+    return fields;
+}
+
+void TestGpgContext::serverProtocol() {
+
+        GpgServer server(mCtx);
+        QVERIFY(server.listen("gpg4usb-test"));
+
+        QLocalSocket socket;
+        socket.connectToServer("gpg4usb-test");
+        QVERIFY(socket.waitForConnected(1000));
+
+        // two pipelined requests, the header and the data split across reads
+        socket.write("1 encrypt 5 nobody@exa");
+        socket.flush();
+        QTest::qWait(50);
+        socket.write("mple.org\nhel");
+        socket.flush();
+        QTest::qWait(50);
+        socket.write("lo2 stats 0\n");
+
+        QByteArray body;
+        QList<QByteArray> response = readServerResponse(&socket, &body);
+        QCOMPARE(response.size(), 4);
+        QCOMPARE(response.at(0), QByteArray("1"));
+        QCOMPARE(response.at(1), QByteArray("ERROR"));
+        QCOMPARE(response.at(2).toInt(), body.size());
+        QCOMPARE(body, QByteArray("no key found for nobody@example.org"));
+
+        response = readServerResponse(&socket, &body);
+        QCOMPARE(response.size(), 4);
+        QCOMPARE(response.at(0), QByteArray("2"));
+        QCOMPARE(response.at(1), QByteArray("OK"));
+        QCOMPARE(response.at(2).toInt(), body.size());
+        QVERIFY(body.startsWith("encrypt count=1 failed=1 "));
+        // the stats request itself is still pending
+        QVERIFY(body.endsWith("pending=1\n"));
+
+        // a malformed header can't be framed, the connection is closed
+        socket.write("3 frobnicate 0\n");
+        response = readServerResponse(&socket, &body);
+        QCOMPARE(response.size(), 4);
+        QCOMPARE(response.at(0), QByteArray("3"));
+        QCOMPARE(response.at(1), QByteArray("ERROR"));
+        QCOMPARE(body, QByteArray("malformed header"));
+        for (int i = 0; i < 50 && socket.state() != QLocalSocket::UnconnectedState; i++) {
+            QTest::qWait(20);
+        }
+        QCOMPARE(socket.state(), QLocalSocket::UnconnectedState);
+}
+
 QTEST_MAIN(TestGpgContext)
 #include "testgpgcontext.moc"